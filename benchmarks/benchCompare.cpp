@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench_common.hpp"
+#include "CF.hpp"
+#include "Hash.hpp"
+#include "LDCF.hpp"
+
+// A single cuckoo filter sized for the whole set up front, keys that do not fit are dropped
+class FixedCuckooFilter {
+public:
+    FixedCuckooFilter(std::size_t set_size, double false_positive_rate):
+        filter(static_cast<std::size_t>(std::ceil(set_size / (BUCKET_SIZE * LOAD_FACTOR))),
+               static_cast<std::size_t>(std::ceil(std::log2(2 * BUCKET_SIZE / false_positive_rate))), 0) {}
+
+    bool insert(std::string_view item) {
+        return !filter.isFull() && !filter.insert(item).has_value();
+    }
+
+    bool contains(std::string_view item) const { return filter.contains(item); }
+
+    std::size_t memoryUsage() const { return filter.memoryUsage(); }
+
+private:
+    CuckooFilter filter;
+};
+
+// Dynamic cuckoo filter: a list of equal cuckoo filters, a new one is appended when the last one is full
+// and every lookup probes all of them
+class DynamicCuckooFilter {
+public:
+    DynamicCuckooFilter(std::size_t set_size, double false_positive_rate, std::size_t expected_levels):
+        number_of_buckets(std::max<std::size_t>(1, set_size / (BUCKET_SIZE * expected_levels))),
+        // the rate of one filter, a lookup probes about expected_levels of them
+        fingerprint_size(static_cast<std::size_t>(std::ceil(std::log2(2 * BUCKET_SIZE * expected_levels / false_positive_rate)))) {
+        fingerprint_size = std::min<std::size_t>(fingerprint_size, BYTE_SIZE * 4);
+        filters.push_back(std::make_unique<CuckooFilter>(number_of_buckets, fingerprint_size, 0));
+    }
+
+    bool insert(std::string_view item) {
+        if (filters.back()->isFull()) {
+            filters.push_back(std::make_unique<CuckooFilter>(number_of_buckets, fingerprint_size, 0));
+        }
+        auto victim = filters.back()->insert(item);
+        if (victim.has_value()) {
+            // the filters are equal, the victim keeps its bucket in the next one
+            filters.push_back(std::make_unique<CuckooFilter>(number_of_buckets, fingerprint_size, 0));
+            filters.back()->insert(victim.value());
+        }
+        return true;
+    }
+
+    bool contains(std::string_view item) const {
+        auto key = filters.front()->hashKey(item);
+        return std::any_of(filters.begin(), filters.end(), [&](const auto &filter) { return filter->contains(key); });
+    }
+
+    std::size_t memoryUsage() const {
+        std::size_t bytes = sizeof(*this);
+        for (const auto &filter : filters) {
+            bytes += filter->memoryUsage();
+        }
+        return bytes;
+    }
+
+private:
+    std::size_t number_of_buckets;
+    std::size_t fingerprint_size;
+    std::vector<std::unique_ptr<CuckooFilter>> filters;
+};
+
+// Bloom filter whose k bits of a key all fall into one cache line
+class BlockedBloomFilter {
+public:
+    BlockedBloomFilter(std::size_t set_size, double false_positive_rate):
+        hashes(std::max(1, static_cast<int>(std::lround(-std::log2(false_positive_rate))))) {
+        // k / ln 2 bits per item is optimal for a plain Bloom filter
+        auto bits = static_cast<std::size_t>(std::ceil(set_size * hashes / std::log(2.0)));
+        blocks = std::max<std::size_t>(1, (bits + BLOCK_BITS - 1) / BLOCK_BITS);
+        words.assign(blocks * BLOCK_WORDS, 0);
+    }
+
+    bool insert(std::string_view item) {
+        auto hash = DefaultHashPolicy::hash(item);
+        auto *block = words.data() + blockOf(hash) * BLOCK_WORDS;
+        forEachBit(hash, [&](uint32_t bit) { block[bit / 64] |= 1ULL << (bit % 64); });
+        return true;
+    }
+
+    bool contains(std::string_view item) const {
+        auto hash = DefaultHashPolicy::hash(item);
+        const auto *block = words.data() + blockOf(hash) * BLOCK_WORDS;
+        bool found = true;
+        forEachBit(hash, [&](uint32_t bit) { found &= ((block[bit / 64] >> (bit % 64)) & 1U) != 0; });
+        return found;
+    }
+
+    std::size_t memoryUsage() const { return sizeof(*this) + words.size() * sizeof(uint64_t); }
+
+private:
+    static const std::size_t BLOCK_BITS = 512;
+    static const std::size_t BLOCK_WORDS = BLOCK_BITS / 64;
+
+    int hashes;
+    std::size_t blocks;
+    std::vector<uint64_t> words;
+
+    std::size_t blockOf(uint64_t hash) const {
+        return static_cast<std::size_t>(((hash >> 32) * blocks) >> 32);
+    }
+
+    // double hashing inside the block, from bits not used to pick the block
+    template <typename Visit>
+    void forEachBit(uint64_t hash, Visit &&visit) const {
+        auto mixed = DefaultHashPolicy::hash(hash);
+        auto h1 = static_cast<uint32_t>(hash);
+        auto h2 = static_cast<uint32_t>(mixed) | 1U;
+        for (int i = 0; i < hashes; i++) {
+            visit((h1 + static_cast<uint32_t>(i) * h2) % BLOCK_BITS);
+        }
+    }
+};
+
+// The exact set, for reference
+class ExactSet {
+public:
+    explicit ExactSet(std::size_t set_size) { set.reserve(set_size); }
+
+    bool insert(std::string_view item) { return set.emplace(item).second; }
+
+    // looks up through one reused buffer, so the timing is the lookup and not a string allocation per query
+    bool contains(std::string_view item) const {
+        probe.assign(item);
+        return set.find(probe) != set.end();
+    }
+
+    // unknown, the resident set growth stands in for it
+    std::size_t memoryUsage() const { return 0; }
+
+private:
+    std::unordered_set<std::string> set;
+    mutable std::string probe;
+};
+
+// Resident set size of this process right now
+std::size_t current_rss() {
+    long pages = 0;
+    long resident = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm != nullptr) {
+        if (fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(statm);
+    }
+    return static_cast<std::size_t>(resident) * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// Peak resident set size of this process
+std::size_t peak_rss() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+}
+
+// Run the key streams through one structure in a child process, so its peak RSS is its own, and print a row
+template <typename Make>
+void run_structure(const std::string& name, Make make, const std::vector<std::string>& keys,
+                   const std::vector<std::string>& false_strings, const std::unordered_map<std::string_view, bool>& string_map) {
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "fork failed, skipping " << name << std::endl;
+        return;
+    }
+    if (pid > 0) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        return;
+    }
+
+    auto rss_before = current_rss();
+    auto structure = make();
+
+    std::size_t stored = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& key : keys) {
+        // the LDCF stores every key, the baselines say whether they did
+        if constexpr (std::is_void_v<decltype(structure->insert(key))>) {
+            structure->insert(key);
+            stored++;
+        } else {
+            stored += structure->insert(key) ? 1 : 0;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> insert_time = end - start;
+
+    // printed, so no lookup can be optimized away
+    std::size_t found = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (const auto& key : keys) {
+        found += structure->contains(key) ? 1 : 0;
+    }
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> lookup_time = end - start;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (const auto& key : false_strings) {
+        found += structure->contains(key) ? 1 : 0;
+    }
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> negative_time = end - start;
+
+    auto false_positives = count_false_positives(false_strings, string_map, [&](const std::string& seq) { return structure->contains(seq); });
+
+    // the child starts with the parent's pages resident, only what it added belongs to the structure
+    auto rss_after = current_rss();
+    auto rss_growth = rss_after - std::min(rss_after, rss_before);
+    auto peak_growth = peak_rss() - std::min(peak_rss(), rss_before);
+    auto bytes = structure->memoryUsage() != 0 ? structure->memoryUsage() : rss_growth;
+
+    std::cout << name << "\t" << keys.size() / insert_time.count() << "\t" << keys.size() / lookup_time.count() << "\t"
+              << false_strings.size() / negative_time.count() << "\t" << false_positives.rate() << "\t"
+              << static_cast<double>(bytes) * BYTE_SIZE / keys.size() << "\t" << peak_growth / (1024.0 * 1024.0) << "\t"
+              << rss_growth / (1024.0 * 1024.0) << "\t" << keys.size() - stored << "\t" << found << std::endl;
+    _exit(0);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 5) {
+        std::cerr << "Usage: " << argv[0] << " <number_of_keys> <string_length> <false_positive_rate> <expected_levels>" << std::endl;
+        return 1;
+    }
+    std::size_t number_of_keys = std::stoul(argv[1]);
+    std::size_t string_length = std::stoul(argv[2]);
+    double false_positive_rate = std::stod(argv[3]);
+    std::size_t expected_levels = std::stoul(argv[4]);
+
+    // one key stream for every structure
+    auto keys = generate_random_strings(number_of_keys, string_length);
+    auto false_strings = generate_random_strings(number_of_keys, string_length);
+    std::unordered_map<std::string_view, bool> string_map;
+    string_map.reserve(keys.size());
+    for (const auto& key : keys) {
+        string_map.emplace(key, true);
+    }
+
+    std::cout << "keys: " << number_of_keys << ", key length: " << string_length << ", target false positive rate: "
+              << false_positive_rate << ", expected levels: " << expected_levels << "\n";
+    std::cout << "structure\tinsert ops/s\tpositive lookups/s\tnegative lookups/s\tfalse positive rate\tbits per item"
+              << "\tpeak RSS growth MB\tRSS growth MB\tdropped\thits" << std::endl;
+
+    run_structure("LDCF", [&]() {
+        return std::make_unique<LogarithmicDynamicCuckooFilter>(false_positive_rate, number_of_keys, expected_levels);
+    }, keys, false_strings, string_map);
+    run_structure("CuckooFilter", [&]() {
+        return std::make_unique<FixedCuckooFilter>(number_of_keys, false_positive_rate);
+    }, keys, false_strings, string_map);
+    run_structure("DCF", [&]() {
+        return std::make_unique<DynamicCuckooFilter>(number_of_keys, false_positive_rate, expected_levels);
+    }, keys, false_strings, string_map);
+    run_structure("BlockedBloom", [&]() {
+        return std::make_unique<BlockedBloomFilter>(number_of_keys, false_positive_rate);
+    }, keys, false_strings, string_map);
+    run_structure("unordered_set", [&]() {
+        return std::make_unique<ExactSet>(number_of_keys);
+    }, keys, false_strings, string_map);
+
+    return 0;
+}
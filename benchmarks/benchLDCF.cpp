@@ -1,55 +1,679 @@
 #include <cstddef>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <chrono>
 #include <unordered_map>
 #include <random> 
+#include <string_view>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "bench_common.hpp"
+#include "BucketProbe.hpp"
+#include "CF.hpp"
+#include "Instrumentation.hpp"
+#include "Kmer.hpp"
+#include "SequenceReader.hpp"
 #include "LDCF.hpp" 
 
-std::vector<std::string> read_sequences_from_fq(const std::string& filename) {
-    std::vector<std::string> sequences;
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Could not open the file " << filename << std::endl;
-        return sequences;
+// run the filter with one hash policy over the same keys and append its results
+template <typename HashPolicy>
+void run_benchmark(std::ofstream& results, const std::vector<std::string_view>& all_substrings,
+                   const std::unordered_map<std::string_view, bool>& string_map, const std::vector<std::string>& false_strings,
+                   std::size_t set_size, double false_positive_rate, std::size_t expected_levels) {
+    BasicLogarithmicDynamicCuckooFilter<HashPolicy> ldcf(false_positive_rate, set_size, expected_levels);
+
+    // time clock
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& seq : all_substrings) {
+        ldcf.insert(seq);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto ldcf_insert_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    std::chrono::duration<double> ldcf_insert_seconds = end - start;
+
+    // positive lookups, every key is in the filter
+    std::size_t found = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (const auto& seq : all_substrings) {
+        found += ldcf.contains(seq) ? 1 : 0;
+    }
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> ldcf_lookup_time = end - start;
+
+    start = std::chrono::high_resolution_clock::now();
+    auto false_positives = count_false_positives(false_strings, string_map, [&](const std::string& seq) { return ldcf.contains(seq); });
+    end = std::chrono::high_resolution_clock::now();
+    auto ldcf_check_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    double ldcf_fp_rate = false_positives.rate();
+
+    // write results to file
+    results << "Hash policy: " << HashPolicy::name << "\n";
+    results << "LDCF Insert Time per entry: " << (double)ldcf_insert_time / all_substrings.size() << " ms\n";
+    results << "LDCF Insert throughput: " << all_substrings.size() / ldcf_insert_seconds.count() << " ops/s\n";
+    results << "LDCF Check Time per entry: " << (double)ldcf_check_time / false_strings.size() << " ms\n";
+    results << "LDCF Positive lookups per second: " << all_substrings.size() / ldcf_lookup_time.count() << " (" << found << " found)\n";
+    results << "LDCF False Positive Rate: " << ldcf_fp_rate << "\n";
+    results << "Number of inserted strings: " << all_substrings.size() << "\n";
+    results << "LDCF Bytes per item: " << (double)ldcf.memoryUsage() / all_substrings.size() << "\n";
+}
+
+// compare one-at-a-time and batched operations on random 64-bit hashes, sized to outgrow the caches
+void run_batch_benchmark(std::size_t num_keys, double false_positive_rate, std::size_t expected_levels) {
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> keys(num_keys);
+    for (auto& key : keys) {
+        key = rng();
+    }
+
+    // half of the queries are inserted keys, half are fresh ones
+    std::vector<uint64_t> queries(num_keys);
+    for (std::size_t i = 0; i < num_keys; ++i) {
+        queries[i] = (i % 2 == 0) ? keys[rng() % num_keys] : rng();
+    }
+
+    LogarithmicDynamicCuckooFilter single(false_positive_rate, num_keys, expected_levels);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (auto key : keys) {
+        single.insert(key);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> single_insert_time = end - start;
+
+    LogarithmicDynamicCuckooFilter batched(false_positive_rate, num_keys, expected_levels);
+    start = std::chrono::high_resolution_clock::now();
+    batched.insert_batch(keys.data(), keys.size());
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> batch_insert_time = end - start;
+
+    std::size_t single_found = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (auto query : queries) {
+        single_found += single.contains(query) ? 1 : 0;
+    }
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> single_lookup_time = end - start;
+
+    std::vector<uint64_t> bitmap((num_keys + 63) / 64);
+    start = std::chrono::high_resolution_clock::now();
+    batched.contains_batch(queries.data(), queries.size(), bitmap.data());
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> batch_lookup_time = end - start;
+
+    std::size_t batch_found = 0;
+    for (auto word : bitmap) {
+        batch_found += __builtin_popcountll(word);
+    }
+
+    std::ofstream results("results.txt", std::ios::app);
+    results << "Batch benchmark keys: " << num_keys << ", filter bytes: " << batched.memoryUsage() << "\n";
+    results << "LDCF insert throughput: " << num_keys / single_insert_time.count() << " ops/s\n";
+    results << "LDCF insert_batch throughput: " << num_keys / batch_insert_time.count() << " ops/s\n";
+    results << "LDCF contains throughput: " << num_keys / single_lookup_time.count() << " ops/s (" << single_found << " found)\n";
+    results << "LDCF contains_batch throughput: " << num_keys / batch_lookup_time.count() << " ops/s (" << batch_found << " found)\n";
+}
+
+// insert the same keys with 1, 2, 4, ... threads and report the speedup over one thread
+void run_parallel_benchmark(std::size_t num_keys, double false_positive_rate, std::size_t expected_levels, std::size_t max_threads) {
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> keys(num_keys);
+    for (auto& key : keys) {
+        key = rng();
+    }
+
+    std::ofstream results("results.txt", std::ios::app);
+    results << "Parallel insert benchmark keys: " << num_keys << ", hardware threads: " << std::thread::hardware_concurrency() << "\n";
+    double single_thread_seconds = 0;
+    for (std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+        LogarithmicDynamicCuckooFilter ldcf(false_positive_rate, num_keys, expected_levels);
+        auto start = std::chrono::high_resolution_clock::now();
+        ldcf.insert_parallel(keys.data(), keys.size(), threads);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> insert_time = end - start;
+        if (threads == 1) {
+            single_thread_seconds = insert_time.count();
+        }
+        results << "LDCF insert_parallel threads: " << threads << ", throughput: " << num_keys / insert_time.count()
+                << " ops/s, speedup: " << single_thread_seconds / insert_time.count() << "\n";
+    }
+}
+
+// read throughput of several reader threads, first while one writer inserts as many keys again, then alone
+void run_concurrent_benchmark(std::size_t num_keys, double false_positive_rate, std::size_t expected_levels, std::size_t reader_threads) {
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> keys(2 * num_keys);
+    for (auto& key : keys) {
+        key = rng();
+    }
+
+    LogarithmicDynamicCuckooFilter ldcf(false_positive_rate, 2 * num_keys, expected_levels);
+    ldcf.insert_batch(keys.data(), num_keys);
+
+    // every reader queries the prefilled keys until told to stop
+    auto measure_reads = [&](const std::function<void()>& meanwhile) {
+        std::atomic<bool> stop{false};
+        std::atomic<std::size_t> total_reads{0};
+        std::vector<std::thread> readers;
+        for (std::size_t t = 0; t < reader_threads; ++t) {
+            readers.emplace_back([&, t]() {
+                std::size_t reads = 0;
+                std::size_t found = 0;
+                uint64_t position = t * 7919;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    found += ldcf.contains(keys[position % num_keys]) ? 1 : 0;
+                    position += 104729;
+                    reads++;
+                }
+                total_reads += reads + (found == 0 ? 1 : 0); // keep the lookups from being optimized out
+            });
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        meanwhile();
+        auto end = std::chrono::high_resolution_clock::now();
+        stop = true;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        std::chrono::duration<double> elapsed = end - start;
+        return std::make_pair(total_reads.load() / elapsed.count(), elapsed.count());
+    };
+
+    auto with_writer = measure_reads([&]() {
+        for (std::size_t i = num_keys; i < keys.size(); ++i) {
+            ldcf.insert(keys[i]);
+        }
+    });
+    auto alone = measure_reads([&]() {
+        std::this_thread::sleep_for(std::chrono::duration<double>(with_writer.second));
+    });
+
+    std::ofstream results("results.txt", std::ios::app);
+    results << "Concurrent benchmark keys: " << num_keys << " prefilled + " << num_keys << " inserted, reader threads: " << reader_threads << "\n";
+    results << "LDCF writer throughput with readers: " << num_keys / with_writer.second << " ops/s\n";
+    results << "LDCF read throughput with a writer: " << with_writer.first << " ops/s\n";
+    results << "LDCF read throughput without a writer: " << alone.first << " ops/s\n";
+}
+
+// pin the calling thread to one CPU, false where affinity is not supported
+bool pin_to_cpu(std::size_t cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// lookups of one prebuilt filter from 1..max_threads pinned threads, each with its own key stream of present
+// and absent keys; with no shared state in the read path the aggregate grows linearly
+void run_scaling_benchmark(std::size_t num_keys, double false_positive_rate, std::size_t expected_levels, std::size_t max_threads) {
+    const std::size_t key_length = 16;
+    auto present = make_keys(num_keys, key_length, 42);
+    LogarithmicDynamicCuckooFilter ldcf(false_positive_rate, num_keys, expected_levels);
+    ldcf.insert_batch(present);
+
+    std::vector<std::size_t> thread_counts;
+    for (std::size_t threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    std::ofstream results("results.txt", std::ios::app);
+    auto cpus = std::max(1U, std::thread::hardware_concurrency());
+    results << "Scaling benchmark keys: " << num_keys << ", lookups per thread: " << num_keys << ", hardware threads: " << cpus << "\n";
+    double single_thread_throughput = 0;
+    for (auto threads : thread_counts) {
+        std::atomic<std::size_t> ready{0};
+        std::atomic<bool> go{false};
+        std::atomic<std::size_t> pinned{0};
+        std::vector<double> seconds(threads);
+        std::vector<std::size_t> found(threads);
+        std::vector<std::thread> readers;
+        for (std::size_t t = 0; t < threads; ++t) {
+            readers.emplace_back([&, t]() {
+                pinned += pin_to_cpu(t % cpus) ? 1 : 0;
+                // built by the thread itself, so its pages are local to it
+                std::mt19937_64 rng(1000 + t);
+                auto queries = make_keys(num_keys, key_length, 2000 + t);
+                for (auto& query : queries) {
+                    if (rng() % 2 == 0) {
+                        query = present[rng() % present.size()];
+                    }
+                }
+                ready++;
+                while (!go.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+                std::size_t hits = 0;
+                auto start = std::chrono::high_resolution_clock::now();
+                for (const auto& query : queries) {
+                    hits += ldcf.contains(query) ? 1 : 0;
+                }
+                auto end = std::chrono::high_resolution_clock::now();
+                seconds[t] = std::chrono::duration<double>(end - start).count();
+                found[t] = hits;
+            });
+        }
+        while (ready.load() != threads) {
+            std::this_thread::yield();
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        go.store(true, std::memory_order_release);
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+
+        auto aggregate = threads * num_keys / elapsed.count();
+        if (threads == 1) {
+            single_thread_throughput = aggregate;
+        }
+        double slowest = num_keys / *std::max_element(seconds.begin(), seconds.end());
+        double fastest = num_keys / *std::min_element(seconds.begin(), seconds.end());
+        std::size_t hits = 0;
+        for (auto h : found) {
+            hits += h;
+        }
+        results << "LDCF contains threads: " << threads << (pinned == threads ? " pinned" : " unpinned")
+                << (threads > cpus ? " oversubscribed" : "") << ", aggregate: " << aggregate
+                << " ops/s, per thread: " << aggregate / threads << " ops/s (slowest " << slowest << ", fastest " << fastest
+                << "), efficiency: " << aggregate / (threads * single_thread_throughput)
+                << ", hit rate: " << static_cast<double>(hits) / (threads * num_keys) << "\n";
+    }
+}
+
+// time one probe kernel over random bucket pairs, in ns per probe
+template <typename Probe>
+double time_probes(const std::vector<char>& slab, std::size_t bytes_per_bucket, const std::vector<uint32_t>& pairs,
+                   const std::vector<uint32_t>& needles, Probe probe, std::size_t& found) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = 0; i < needles.size(); ++i) {
+        const char* bucket1 = slab.data() + pairs[2 * i] * bytes_per_bucket;
+        const char* bucket2 = slab.data() + pairs[2 * i + 1] * bytes_per_bucket;
+        found += probe(bucket1, bucket2, needles[i]) != 0 ? 1 : 0;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::nano> elapsed = end - start;
+    return elapsed.count() / needles.size();
+}
+
+// probe kernels of one width: runtime width scalar and AVX2 against the compiled FixedBucket kernel,
+// then whole filters of that width with the runtime width and the compiled kernels
+template <unsigned Bits>
+void run_width_benchmark(std::ofstream& results, std::size_t num_buckets) {
+    std::mt19937_64 rng(Bits);
+    const uint32_t mask = Bits == 32 ? 0xFFFFFFFFU : (1U << Bits) - 1;
+    auto bytes_per_bucket = Bucket::bytesPerBucket(Bits);
+    std::vector<char> slab(num_buckets * bytes_per_bucket + sizeof(uint64_t), 0);
+    for (std::size_t b = 0; b < num_buckets; ++b) {
+        for (std::size_t i = 0; i < BUCKET_SIZE; ++i) {
+            FixedBucket<Bits, BUCKET_SIZE>::write(slab.data() + b * bytes_per_bucket, i, rng() & mask);
+            FixedBucket<Bits, BUCKET_SIZE>::setOccupied(slab.data() + b * bytes_per_bucket, i, true);
+        }
+    }
+    std::vector<uint32_t> pairs(2 * num_buckets);
+    std::vector<uint32_t> needles(num_buckets);
+    for (std::size_t i = 0; i < num_buckets; ++i) {
+        pairs[2 * i] = rng() % num_buckets;
+        pairs[2 * i + 1] = rng() % num_buckets;
+        // half of the needles are in their first bucket
+        needles[i] = i % 2 == 0 ? FixedBucket<Bits, BUCKET_SIZE>::read(slab.data() + pairs[2 * i] * bytes_per_bucket, rng() % BUCKET_SIZE)
+                                : static_cast<uint32_t>(rng() & mask);
+    }
+
+    std::size_t found = 0;
+    auto scalar = time_probes(slab, bytes_per_bucket, pairs, needles, [](const char* b1, const char* b2, uint32_t fp) {
+        return probeBucketsScalar(b1, b2, fp, Bits);
+    }, found);
+    auto selected = selectProbe();
+    auto runtime = time_probes(slab, bytes_per_bucket, pairs, needles, [selected](const char* b1, const char* b2, uint32_t fp) {
+        return selected(b1, b2, fp, Bits);
+    }, found);
+    auto fixed = time_probes(slab, bytes_per_bucket, pairs, needles, [](const char* b1, const char* b2, uint32_t fp) {
+        return FixedBucket<Bits, BUCKET_SIZE>::probe(b1, b2, fp);
+    }, found);
+
+    // whole filters: fill to the load factor, then look up as many keys again
+    double insert_rate[2];
+    double lookup_rate[2];
+    for (int specialized = 0; specialized < 2; ++specialized) {
+        CuckooFilter cf(num_buckets, Bits, 0);
+        cf.specializeKernels(specialized == 1);
+        std::mt19937_64 keys(42);
+        auto count = cf.capacity();
+        auto start = std::chrono::high_resolution_clock::now();
+        for (std::size_t i = 0; i < count; ++i) {
+            cf.insert(HashedKey::fromHash(keys(), Bits));
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> insert_time = end - start;
+        start = std::chrono::high_resolution_clock::now();
+        for (std::size_t i = 0; i < count; ++i) {
+            found += cf.contains(HashedKey::fromHash(keys(), Bits)) ? 1 : 0;
+        }
+        end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> lookup_time = end - start;
+        insert_rate[specialized] = count / insert_time.count();
+        lookup_rate[specialized] = count / lookup_time.count();
+    }
+
+    results << Bits << "\t" << scalar << "\t" << runtime << "\t" << fixed << "\t"
+            << insert_rate[0] << "\t" << insert_rate[1] << "\t" << lookup_rate[0] << "\t" << lookup_rate[1]
+            << "\t" << (CuckooFilter(1, Bits, 0).usesCompiledKernels() ? "compiled" : "runtime")
+            << (found == 0 ? "\t-" : "") << "\n";
+}
+
+template <unsigned... Offsets>
+void run_kernel_benchmark(std::size_t num_buckets, std::integer_sequence<unsigned, Offsets...>) {
+    std::ofstream results("results.txt", std::ios::app);
+    results << "Kernel benchmark buckets: " << num_buckets << "\n";
+    results << "bits\tscalar ns/probe\tselected ns/probe\tcompiled ns/probe\truntime insert ops/s\tcompiled insert ops/s"
+            << "\truntime contains ops/s\tcompiled contains ops/s\tdefault\n";
+    (run_width_benchmark<MIN_SPECIALIZED_WIDTH + Offsets>(results, num_buckets), ...);
+}
+
+// lookups on a tree that grew well past expected_levels, the filter is sized for num_keys and gets overfill times as many
+void run_growth_benchmark(std::size_t num_keys, double false_positive_rate, std::size_t expected_levels, std::size_t overfill) {
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> keys(num_keys * overfill);
+    for (auto& key : keys) {
+        key = rng();
+    }
+    std::vector<uint64_t> queries(keys.size());
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+        queries[i] = (i % 2 == 0) ? keys[rng() % keys.size()] : rng();
+    }
+
+    LogarithmicDynamicCuckooFilter ldcf(false_positive_rate, num_keys, expected_levels);
+    ldcf.insert_batch(keys.data(), keys.size());
+
+    std::size_t found = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (auto query : queries) {
+        found += ldcf.contains(query) ? 1 : 0;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> lookup_time = end - start;
+
+    std::ofstream results("results.txt", std::ios::app);
+    results << "Growth benchmark keys: " << keys.size() << " in a filter sized for " << num_keys
+            << ", bytes per item: " << static_cast<double>(ldcf.memoryUsage()) / keys.size() << "\n";
+    results << "LDCF contains throughput: " << queries.size() / lookup_time.count() << " ops/s (" << found << " found)\n";
+    results << "Stats: " << ldcf.stats().toJson() << "\n";
+    if (Instrumentation::enabled) {
+        results << "Counters: " << Instrumentation::snapshot().toJson() << "\n";
+    }
+}
+
+// the same overfilled key set under growth factors 1 (every node the size of the root), 2, 4 and 8:
+// depth, memory, lookup latency and measured false positive rate
+void run_geometric_benchmark(std::size_t num_keys, double false_positive_rate, std::size_t expected_levels, std::size_t overfill) {
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> keys(num_keys * overfill);
+    for (auto& key : keys) {
+        key = rng();
+    }
+    std::vector<uint64_t> present(keys.size());
+    std::vector<uint64_t> absent(keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        present[i] = keys[rng() % keys.size()];
+        absent[i] = rng();
+    }
+
+    std::ofstream results("results.txt", std::ios::app);
+    results << "Geometric growth benchmark keys: " << keys.size() << " in a filter sized for " << num_keys << "\n";
+    for (std::size_t growth_factor : {1, 2, 4, 8}) {
+        LogarithmicDynamicCuckooFilter ldcf(false_positive_rate, num_keys, expected_levels, growth_factor);
+        auto start = std::chrono::high_resolution_clock::now();
+        ldcf.insert_batch(keys.data(), keys.size());
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::nano> insert_time = end - start;
+
+        std::size_t found = 0;
+        start = std::chrono::high_resolution_clock::now();
+        for (auto query : present) {
+            found += ldcf.contains(query) ? 1 : 0;
+        }
+        end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::nano> positive_time = end - start;
+
+        std::size_t false_positives = 0;
+        start = std::chrono::high_resolution_clock::now();
+        for (auto query : absent) {
+            false_positives += ldcf.contains(query) ? 1 : 0;
+        }
+        end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::nano> negative_time = end - start;
+
+        auto stats = ldcf.stats();
+        results << "LDCF growth factor: " << growth_factor << ", levels: " << stats.nodes_per_level.size()
+                << ", nodes: " << stats.nodes << ", mean path length: " << stats.mean_path_length
+                << ", bits per item: " << stats.bits_per_item << ", insert: " << insert_time.count() / keys.size()
+                << " ns, positive lookup: " << positive_time.count() / present.size()
+                << " ns, negative lookup: " << negative_time.count() / absent.size()
+                << " ns, false positive rate: " << static_cast<double>(false_positives) / absent.size()
+                << " (estimated " << stats.false_positive_rate << "), found: " << found << "\n";
     }
-    std::string line;
-    while (std::getline(file, line)) {
-        if (line[0] == '@') {
-            std::getline(file, line); // Sequence line
-            sequences.push_back(line);
-            std::getline(file, line); // Skip '+'
-            std::getline(file, line); // Skip quality line
+}
+
+// memory and lookups after most keys are removed again, before and after compaction
+void run_churn_benchmark(std::size_t num_keys, double false_positive_rate, std::size_t expected_levels, std::size_t keep_percent) {
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> keys(num_keys);
+    for (auto& key : keys) {
+        key = rng();
+    }
+    auto kept = num_keys * keep_percent / 100;
+
+    LogarithmicDynamicCuckooFilter ldcf(false_positive_rate, num_keys, expected_levels);
+    ldcf.insert_batch(keys.data(), keys.size());
+    auto peak = ldcf.memoryUsage();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = kept; i < num_keys; ++i) {
+        ldcf.remove(keys[i]);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> remove_time = end - start;
+
+    auto lookups = [&]() {
+        std::size_t found = 0;
+        auto lookup_start = std::chrono::high_resolution_clock::now();
+        for (std::size_t i = 0; i < num_keys; ++i) {
+            found += ldcf.contains(keys[i]) ? 1 : 0;
         }
+        auto lookup_end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> lookup_time = lookup_end - lookup_start;
+        return std::make_pair(num_keys / lookup_time.count(), found);
+    };
+    auto before = lookups();
+    auto removed_memory = ldcf.memoryUsage();
+
+    start = std::chrono::high_resolution_clock::now();
+    auto freed = ldcf.compact();
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> compact_time = end - start;
+    auto after = lookups();
+
+    std::ofstream results("results.txt", std::ios::app);
+    results << "Churn benchmark keys: " << num_keys << ", kept: " << kept << "\n";
+    results << "Bytes at peak: " << peak << ", after remove: " << removed_memory << ", after compact: " << ldcf.memoryUsage()
+            << " (" << freed << " nodes freed)\n";
+    results << "LDCF remove throughput: " << (num_keys - kept) / remove_time.count() << " ops/s, compact time: "
+            << compact_time.count() << " s\n";
+    results << "LDCF contains throughput before compact: " << before.first << " ops/s (" << before.second << " found), after: "
+            << after.first << " ops/s (" << after.second << " found)\n";
+    results << "Stats: " << ldcf.stats().toJson() << "\n";
+    if (Instrumentation::enabled) {
+        results << "Counters: " << Instrumentation::snapshot().toJson() << "\n";
+    }
+}
+
+// startup time of a saved filter, read into memory or mapped, against building it again
+void run_persist_benchmark(std::size_t num_keys, double false_positive_rate, std::size_t expected_levels) {
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> keys(num_keys);
+    for (auto& key : keys) {
+        key = rng();
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    LogarithmicDynamicCuckooFilter ldcf(false_positive_rate, num_keys, expected_levels);
+    ldcf.insert_batch(keys.data(), keys.size());
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> build_time = end - start;
+
+    std::string path = "benchLDCF_filter.bin";
+    start = std::chrono::high_resolution_clock::now();
+    ldcf.save(path);
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> save_time = end - start;
+
+    start = std::chrono::high_resolution_clock::now();
+    auto loaded = LogarithmicDynamicCuckooFilter::load(path);
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> load_time = end - start;
+
+    start = std::chrono::high_resolution_clock::now();
+    auto mapped = LogarithmicDynamicCuckooFilter::open_mapped(path);
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> open_time = end - start;
+
+    std::size_t found = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (auto key : keys) {
+        found += mapped->contains(key) ? 1 : 0;
+    }
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> mapped_lookup_time = end - start;
+    std::remove(path.c_str());
+
+    std::ofstream results("results.txt", std::ios::app);
+    results << "Persist benchmark keys: " << num_keys << ", filter bytes: " << ldcf.memoryUsage() << "\n";
+    results << "LDCF build time: " << build_time.count() << " s\n";
+    results << "LDCF save time: " << save_time.count() << " s\n";
+    results << "LDCF load time: " << load_time.count() << " s (" << loaded->size() << " items)\n";
+    results << "LDCF open_mapped time: " << open_time.count() << " s\n";
+    results << "LDCF mapped contains throughput: " << num_keys / mapped_lookup_time.count() << " ops/s (" << found << " found)\n";
+}
+
+// insert the canonical k-mers of the first file, then query both files, straight from the 2-bit encoding
+void run_kmer_benchmark(const std::string& file1, const std::string& file2, std::size_t k, double false_positive_rate, std::size_t expected_levels) {
+    // both files are streamed straight out of their mappings
+    SequenceReader reader1(file1);
+    SequenceReader reader2(file2);
+    KmerEncoder encoder(k, true);
+
+    std::size_t total_kmers = 0;
+    for (const auto& record : reader1) {
+        total_kmers += encoder.count(record.sequence);
     }
-    file.close();
-    // print number of sequences and first sequence
-    return sequences;
-};
 
+    LogarithmicDynamicCuckooFilter ldcf(false_positive_rate, total_kmers, expected_levels);
 
-// function for generation random strings
-std::vector<std::string> generate_random_strings(std::size_t num_strings, std::size_t string_length) {
-    std::vector<std::string> strings;
-    strings.reserve(num_strings);
-    const char charset[] = "ACGT";
-    std::default_random_engine rng(std::random_device{}());
-    std::uniform_int_distribution<> dist(0, 3);
+    std::size_t inserted = 0;
+    reader1.rewind();
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& record : reader1) {
+        inserted += insertKmers(ldcf, encoder, record.sequence);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> insert_time = end - start;
 
-    for (std::size_t i = 0; i < num_strings; ++i) {
-        std::string str(string_length, 0);
-        for (std::size_t j = 0; j < string_length; ++j) {
-            str[j] = charset[dist(rng)];
+    std::size_t queried = 0;
+    std::size_t found = 0;
+    reader1.rewind();
+    start = std::chrono::high_resolution_clock::now();
+    for (auto* reader : {&reader1, &reader2}) {
+        for (const auto& record : *reader) {
+            queried += encoder.count(record.sequence);
+            found += countKmers(ldcf, encoder, record.sequence);
         }
-        strings.push_back(str);
     }
-    return strings;
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> query_time = end - start;
+
+    std::ofstream results("results.txt", std::ios::app);
+    results << "K-mer benchmark k: " << k << ", canonical k-mers inserted: " << inserted << "\n";
+    results << "LDCF k-mer insert throughput: " << inserted / insert_time.count() << " k-mers/s\n";
+    results << "LDCF k-mer query throughput: " << queried / query_time.count() << " k-mers/s (" << found << " of " << queried << " found)\n";
+    results << "LDCF Bytes per k-mer: " << (double)ldcf.memoryUsage() / inserted << "\n";
 }
 
 int main(int argc, char* argv[]) {
+    if (argc == 5 && std::string(argv[1]) == "batch") {
+        run_batch_benchmark(std::stoul(argv[2]), std::stod(argv[3]), std::stoul(argv[4]));
+        return 0;
+    }
+
+    if (argc == 6 && std::string(argv[1]) == "churn") {
+        run_churn_benchmark(std::stoul(argv[2]), std::stod(argv[3]), std::stoul(argv[4]), std::stoul(argv[5]));
+        return 0;
+    }
+
+    if (argc == 3 && std::string(argv[1]) == "kernels") {
+        run_kernel_benchmark(std::stoul(argv[2]), std::make_integer_sequence<unsigned, MAX_SPECIALIZED_WIDTH - MIN_SPECIALIZED_WIDTH + 1>{});
+        return 0;
+    }
+
+    if (argc == 6 && std::string(argv[1]) == "growth") {
+        run_growth_benchmark(std::stoul(argv[2]), std::stod(argv[3]), std::stoul(argv[4]), std::stoul(argv[5]));
+        return 0;
+    }
+
+    if (argc == 6 && std::string(argv[1]) == "geometric") {
+        run_geometric_benchmark(std::stoul(argv[2]), std::stod(argv[3]), std::stoul(argv[4]), std::stoul(argv[5]));
+        return 0;
+    }
+    if (argc == 5 && std::string(argv[1]) == "persist") {
+        run_persist_benchmark(std::stoul(argv[2]), std::stod(argv[3]), std::stoul(argv[4]));
+        return 0;
+    }
+
+    if (argc == 6 && std::string(argv[1]) == "concurrent") {
+        run_concurrent_benchmark(std::stoul(argv[2]), std::stod(argv[3]), std::stoul(argv[4]), std::stoul(argv[5]));
+        return 0;
+    }
+
+    if (argc == 6 && std::string(argv[1]) == "scaling") {
+        run_scaling_benchmark(std::stoul(argv[2]), std::stod(argv[3]), std::stoul(argv[4]), std::stoul(argv[5]));
+        return 0;
+    }
+    if (argc == 6 && std::string(argv[1]) == "parallel") {
+        run_parallel_benchmark(std::stoul(argv[2]), std::stod(argv[3]), std::stoul(argv[4]), std::stoul(argv[5]));
+        return 0;
+    }
+
+    if (argc == 5 && std::string(argv[1]) == "kmer") {
+        run_kmer_benchmark("../benchmarks/reads_1.fq", "../benchmarks/reads_2.fq", std::stoul(argv[2]), std::stod(argv[3]), std::stoul(argv[4]));
+        return 0;
+    }
+
     if (argc != 4) {
         std::cerr << "Usage: " << argv[0] << " <string_length> <false_positive_rate> <expected_levels>" << std::endl;
+        std::cerr << "       " << argv[0] << " batch <number_of_keys> <false_positive_rate> <expected_levels>" << std::endl;
+        std::cerr << "       " << argv[0] << " kmer <k> <false_positive_rate> <expected_levels>" << std::endl;
+        std::cerr << "       " << argv[0] << " parallel <number_of_keys> <false_positive_rate> <expected_levels> <max_threads>" << std::endl;
+        std::cerr << "       " << argv[0] << " scaling <number_of_keys> <false_positive_rate> <expected_levels> <max_threads>" << std::endl;
+        std::cerr << "       " << argv[0] << " churn <number_of_keys> <false_positive_rate> <expected_levels> <keep_percent>" << std::endl;
+        std::cerr << "       " << argv[0] << " kernels <number_of_buckets>" << std::endl;
+        std::cerr << "       " << argv[0] << " growth <number_of_keys> <false_positive_rate> <expected_levels> <overfill>" << std::endl;
+        std::cerr << "       " << argv[0] << " geometric <number_of_keys> <false_positive_rate> <expected_levels> <overfill>" << std::endl;
+        std::cerr << "       " << argv[0] << " persist <number_of_keys> <false_positive_rate> <expected_levels>" << std::endl;
+        std::cerr << "       " << argv[0] << " concurrent <number_of_keys> <false_positive_rate> <expected_levels> <reader_threads>" << std::endl;
         return 1;
     }
 
@@ -60,76 +684,52 @@ int main(int argc, char* argv[]) {
     std::size_t expected_levels = std::stoul(argv[3]);
 
 
-    // read data from files
-    auto sequences1 = read_sequences_from_fq(file1);
-    auto sequences2 = read_sequences_from_fq(file2);
-    
-    // bind all seq
-    std::vector<std::string> all_sequences = sequences1;
-    all_sequences.insert(all_sequences.end(), sequences2.begin(), sequences2.end());
+    // read data from files, the records are views into the mapped files
+    SequenceReader reader1(file1);
+    SequenceReader reader2(file2);
 
     // put all sequences in one string
+    std::size_t number_of_sequences = 0;
     std::string all_sequences_str;
-    for (const auto& seq : all_sequences) {
-        all_sequences_str += seq;
-    }
-
-    // now create a vector of all substrings of length `string_length`
-    std::vector<std::string> all_substrings;
-    all_substrings.reserve(all_sequences_str.size() / string_length);
-    for (std::size_t i = 0; i < all_sequences_str.size(); i += string_length) {
-        all_substrings.push_back(all_sequences_str.substr(i, string_length));
+    all_sequences_str.reserve(reader1.fileSize() + reader2.fileSize());
+    for (auto* reader : {&reader1, &reader2}) {
+        for (const auto& record : *reader) {
+            all_sequences_str += record.sequence;
+            number_of_sequences++;
+        }
     }
 
-    // init LogarithmicDynamicCuckooFilter
-    LogarithmicDynamicCuckooFilter ldcf(false_positive_rate, all_sequences.size(), expected_levels);
-
-    // time clock
+    // now create a vector of all substrings of length `string_length`, as views into all_sequences_str
     auto start = std::chrono::high_resolution_clock::now();
-    for (const auto& seq : all_substrings) {
-        ldcf.insert(seq);
+    std::vector<std::string_view> all_substrings;
+    all_substrings.reserve(all_sequences_str.size() / string_length + 1);
+    std::string_view all_sequences_view = all_sequences_str;
+    for (std::size_t i = 0; i < all_sequences_view.size(); i += string_length) {
+        all_substrings.push_back(all_sequences_view.substr(i, string_length));
     }
     auto end = std::chrono::high_resolution_clock::now();
-    auto ldcf_insert_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    std::chrono::duration<double, std::micro> slicing_time = end - start;
 
     // test false positives
-    std::unordered_map<std::string, bool> string_map;
+    std::unordered_map<std::string_view, bool> string_map;
     string_map.reserve(all_substrings.size());
     for (const auto& seq : all_substrings) {
         string_map.emplace(seq, true);
     }
 
-    std::size_t ldcf_false_positives = 0;
-
     // random strings for false positives
     auto false_strings = generate_random_strings(all_substrings.size(), string_length);
-    std::size_t false_positive_oppotunities = 0;
-    start = std::chrono::high_resolution_clock::now();
-    for (const auto& seq : false_strings) {
-        if (ldcf.contains(seq) && string_map.find(seq) == string_map.end()) {
-            ldcf_false_positives++;
-        }
-        if (string_map.find(seq) == string_map.end()) {
-            false_positive_oppotunities++;
-        }
-    }
-
-    end = std::chrono::high_resolution_clock::now();
-    auto ldcf_check_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 
-    double ldcf_fp_rate = (double)ldcf_false_positives / false_positive_oppotunities;
-    
     // check if results.txt exists
     std::ofstream results("results.txt", std::ios::app);
     if (!results.is_open()) {
         // if not, create it
         results.open("results.txt");
     }
-    // write results to file
-    results << "LDCF Insert Time per entry: " << (double)ldcf_insert_time / all_substrings.size() << " ms\n";
-    results << "LDCF Check Time per entry: " << (double)ldcf_check_time / false_strings.size() << " ms\n";
-    results << "LDCF False Positive Rate: " << ldcf_fp_rate << "\n";
-    results << "Number of inserted strings: " << all_substrings.size() << "\n";
+
+    results << "Key slicing time: " << slicing_time.count() << " us for " << all_substrings.size() << " keys (string_view, no allocation per key)\n";
+    run_benchmark<StdHashPolicy>(results, all_substrings, string_map, false_strings, number_of_sequences, false_positive_rate, expected_levels);
+    run_benchmark<WyHashPolicy>(results, all_substrings, string_map, false_strings, number_of_sequences, false_positive_rate, expected_levels);
 
     return 0;
 }
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "LDCF.hpp"
+#include "Workload.hpp"
+
+// Operations generated and applied at a time
+const std::size_t WORKLOAD_BATCH = 1 << 16;
+
+// Filter under test and reporting, next to the workload
+struct DriverConfig {
+    std::size_t set_size = 1 << 20;
+    double false_positive_rate = 0.001;
+    std::size_t expected_levels = 4;
+    std::size_t growth_factor = 1;
+    uint64_t report_every = 0;
+};
+
+// Counts of one reporting interval
+struct IntervalCounts {
+    uint64_t operations = 0;
+    uint64_t negative_queries = 0;
+    uint64_t false_positives = 0;
+    uint64_t false_negatives = 0;
+    double seconds = 0;
+};
+
+void print_usage(const char *program) {
+    std::cerr << "Usage: " << program << " operations=<n> [name=value ...]" << std::endl;
+    std::cerr << "  workload: key_length insert query remove positive distribution=uniform|zipfian zipf seed" << std::endl;
+    std::cerr << "  filter:   set_size fpr levels growth" << std::endl;
+    std::cerr << "  output:   report_every (operations per row, default operations/100)" << std::endl;
+}
+
+// Parse name=value arguments into the workload and the driver settings
+void parse_arguments(int argc, char *argv[], WorkloadConfig &workload, DriverConfig &driver) {
+    for (int i = 1; i < argc; i++) {
+        std::string argument(argv[i]);
+        auto equals = argument.find('=');
+        if (equals == std::string::npos) {
+            throw std::runtime_error("Expected name=value, got " + argument);
+        }
+        auto name = argument.substr(0, equals);
+        auto value = argument.substr(equals + 1);
+        if (name == "operations") {
+            workload.operations = std::stoull(value);
+        } else if (name == "key_length") {
+            workload.key_length = std::stoul(value);
+        } else if (name == "insert") {
+            workload.insert_ratio = std::stod(value);
+        } else if (name == "query") {
+            workload.query_ratio = std::stod(value);
+        } else if (name == "remove") {
+            workload.remove_ratio = std::stod(value);
+        } else if (name == "positive") {
+            workload.positive_ratio = std::stod(value);
+        } else if (name == "distribution" && (value == "uniform" || value == "zipfian")) {
+            workload.distribution = value == "uniform" ? KeyDistribution::UNIFORM : KeyDistribution::ZIPFIAN;
+        } else if (name == "zipf") {
+            workload.zipf_exponent = std::stod(value);
+        } else if (name == "seed") {
+            workload.seed = std::stoull(value);
+        } else if (name == "set_size") {
+            driver.set_size = std::stoul(value);
+        } else if (name == "fpr") {
+            driver.false_positive_rate = std::stod(value);
+        } else if (name == "levels") {
+            driver.expected_levels = std::stoul(value);
+        } else if (name == "growth") {
+            driver.growth_factor = std::stoul(value);
+        } else if (name == "report_every") {
+            driver.report_every = std::stoull(value);
+        } else {
+            throw std::runtime_error("Unknown argument " + argument);
+        }
+    }
+    if (workload.operations == 0) {
+        throw std::runtime_error("operations must be given and greater than zero");
+    }
+    if (driver.growth_factor == 0 || (driver.growth_factor & (driver.growth_factor - 1)) != 0) {
+        throw std::runtime_error("growth must be a power of two");
+    }
+    if (driver.report_every == 0) {
+        driver.report_every = std::max<uint64_t>(1, workload.operations / 100);
+    }
+}
+
+// Apply one batch in order, only the filter calls are timed
+void apply_batch(LogarithmicDynamicCuckooFilter &ldcf, const std::vector<Operation> &operations, IntervalCounts &counts) {
+    uint64_t negative_queries = 0;
+    uint64_t false_positives = 0;
+    uint64_t false_negatives = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &operation : operations) {
+        switch (operation.type) {
+            case OperationType::INSERT:
+                ldcf.insert(operation.key);
+                break;
+            case OperationType::REMOVE:
+                ldcf.remove(operation.key);
+                break;
+            case OperationType::QUERY: {
+                bool found = ldcf.contains(operation.key);
+                negative_queries += operation.positive ? 0 : 1;
+                false_positives += !operation.positive && found ? 1 : 0;
+                false_negatives += operation.positive && !found ? 1 : 0;
+                break;
+            }
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    counts.seconds += std::chrono::duration<double>(end - start).count();
+    counts.operations += operations.size();
+    counts.negative_queries += negative_queries;
+    counts.false_positives += false_positives;
+    counts.false_negatives += false_negatives;
+}
+
+// One row per interval: throughput against the shape of the tree at its end
+void print_row(const LogarithmicDynamicCuckooFilter &ldcf, const WorkloadGenerator &generator, const IntervalCounts &counts) {
+    auto stats = ldcf.stats();
+    std::cout << generator.generated() << "\t" << generator.present() << "\t" << counts.operations / counts.seconds / 1e6 << "\t"
+              << (counts.negative_queries == 0 ? 0 : static_cast<double>(counts.false_positives) / counts.negative_queries) << "\t"
+              << counts.false_negatives << "\t" << stats.nodes_per_level.size() << "\t" << stats.nodes << "\t"
+              << stats.mean_path_length << "\t" << stats.bits_per_item << "\t" << stats.total_bytes / (1024.0 * 1024.0) << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    WorkloadConfig workload;
+    DriverConfig driver;
+    std::unique_ptr<WorkloadGenerator> generator;
+    try {
+        parse_arguments(argc, argv, workload, driver);
+        generator = std::make_unique<WorkloadGenerator>(workload);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    LogarithmicDynamicCuckooFilter ldcf(driver.false_positive_rate, driver.set_size, driver.expected_levels, driver.growth_factor);
+
+    std::cout << "operations\tpresent keys\tMops/s\tfalse positive rate\tfalse negatives\tlevels\tnodes"
+              << "\tmean path length\tbits per item\tMB" << std::endl;
+    std::vector<Operation> operations;
+    operations.reserve(WORKLOAD_BATCH);
+    IntervalCounts counts;
+    uint64_t next_report = driver.report_every;
+    while (true) {
+        // stop each batch at the next report, so rows land on multiples of report_every
+        auto batch = static_cast<std::size_t>(std::min<uint64_t>(WORKLOAD_BATCH, next_report - generator->generated()));
+        if (generator->next(operations, batch) == 0) {
+            break;
+        }
+        apply_batch(ldcf, operations, counts);
+        if (generator->generated() == next_report || generator->generated() == workload.operations) {
+            print_row(ldcf, *generator, counts);
+            counts = IntervalCounts();
+            next_report += driver.report_every;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef BENCH_COMMON_HPP
+#define BENCH_COMMON_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// function for generation random strings
+inline std::vector<std::string> generate_random_strings(std::size_t num_strings, std::size_t string_length) {
+    std::vector<std::string> strings;
+    strings.reserve(num_strings);
+    const char charset[] = "ACGT";
+    std::default_random_engine rng(std::random_device{}());
+    std::uniform_int_distribution<> dist(0, 3);
+
+    for (std::size_t i = 0; i < num_strings; ++i) {
+        std::string str(string_length, 0);
+        for (std::size_t j = 0; j < string_length; ++j) {
+            str[j] = charset[dist(rng)];
+        }
+        strings.push_back(str);
+    }
+    return strings;
+}
+
+// random printable keys, different seeds give disjoint sets for any practical length
+inline std::vector<std::string> make_keys(std::size_t count, std::size_t length, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<std::string> keys(count, std::string(length, ' '));
+    for (auto& key : keys) {
+        for (auto& c : key) {
+            c = static_cast<char>('!' + rng() % 94);
+        }
+    }
+    return keys;
+}
+
+// false positives among queries, only queries that really are not in the set count
+struct FalsePositiveCount {
+    std::size_t false_positives = 0;
+    std::size_t opportunities = 0;
+
+    [[nodiscard]] double rate() const { return opportunities == 0 ? 0 : static_cast<double>(false_positives) / opportunities; }
+};
+
+// run every query through contains, string_map holds the keys that were inserted
+template <typename Contains>
+FalsePositiveCount count_false_positives(const std::vector<std::string>& queries,
+                                         const std::unordered_map<std::string_view, bool>& string_map, Contains&& contains) {
+    FalsePositiveCount count;
+    for (const auto& seq : queries) {
+        if (contains(seq) && string_map.find(seq) == string_map.end()) {
+            count.false_positives++;
+        }
+        if (string_map.find(seq) == string_map.end()) {
+            count.opportunities++;
+        }
+    }
+    return count;
+}
+
+#endif // BENCH_COMMON_HPP
@@ -0,0 +1,135 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench_common.hpp"
+#include "LDCF.hpp"
+
+namespace {
+
+// Every filter is sized for this many keys, the fill level is a percentage of it
+const std::size_t SET_SIZE = 1 << 16;
+
+// Keys inserted or removed before the filter is built again
+const std::size_t CHURN_KEYS = SET_SIZE / 4;
+
+/**
+ * One point of the parameter grid
+ * Arguments: false positive rate as 10^-fpr_exp, expected_levels, key length in bytes, fill level in percent
+ */
+struct Config {
+    double false_positive_rate;
+    std::size_t expected_levels;
+    std::size_t key_length;
+    std::size_t keys;
+
+    explicit Config(const benchmark::State &state):
+        false_positive_rate(std::pow(10.0, -static_cast<double>(state.range(0)))),
+        expected_levels(static_cast<std::size_t>(state.range(1))),
+        key_length(static_cast<std::size_t>(state.range(2))),
+        keys(SET_SIZE * static_cast<std::size_t>(state.range(3)) / 100) {}
+};
+
+std::unique_ptr<LogarithmicDynamicCuckooFilter> makeFilter(const Config &config, const std::vector<std::string> &keys) {
+    auto filter = std::make_unique<LogarithmicDynamicCuckooFilter>(config.false_positive_rate, SET_SIZE, config.expected_levels);
+    for (const auto &key : keys) {
+        filter->insert(key);
+    }
+    return filter;
+}
+
+void setCounters(benchmark::State &state, const LogarithmicDynamicCuckooFilter &filter) {
+    state.counters["ops/s"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+    state.counters["bytes/item"] = filter.size() == 0 ? 0 : static_cast<double>(filter.memoryUsage()) / filter.size();
+}
+
+// Insert new keys into a filter at the fill level
+void BM_Insert(benchmark::State &state) {
+    Config config(state);
+    auto present = make_keys(config.keys, config.key_length, 1);
+    auto added = make_keys(CHURN_KEYS, config.key_length, 2);
+    auto filter = makeFilter(config, present);
+
+    std::size_t next = 0;
+    for (auto _ : state) {
+        if (next == added.size()) {
+            state.PauseTiming();
+            filter = makeFilter(config, present);
+            next = 0;
+            state.ResumeTiming();
+        }
+        filter->insert(added[next++]);
+    }
+    setCounters(state, *filter);
+}
+
+// Look up keys that were inserted
+void BM_ContainsPositive(benchmark::State &state) {
+    Config config(state);
+    auto present = make_keys(config.keys, config.key_length, 1);
+    auto filter = makeFilter(config, present);
+
+    std::size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(filter->contains(present[next]));
+        next = next + 1 == present.size() ? 0 : next + 1;
+    }
+    setCounters(state, *filter);
+}
+
+// Look up keys that were never inserted, also reports the measured false positive rate
+void BM_ContainsNegative(benchmark::State &state) {
+    Config config(state);
+    auto present = make_keys(config.keys, config.key_length, 1);
+    auto absent = make_keys(CHURN_KEYS, config.key_length, 3);
+    auto filter = makeFilter(config, present);
+
+    std::size_t next = 0;
+    std::size_t false_positives = 0;
+    for (auto _ : state) {
+        false_positives += filter->contains(absent[next]) ? 1 : 0;
+        next = next + 1 == absent.size() ? 0 : next + 1;
+    }
+    setCounters(state, *filter);
+    state.counters["fpr"] = static_cast<double>(false_positives) / static_cast<double>(state.iterations());
+}
+
+// Remove inserted keys, the filter is built again once they run out
+void BM_Remove(benchmark::State &state) {
+    Config config(state);
+    auto present = make_keys(config.keys, config.key_length, 1);
+    auto filter = makeFilter(config, present);
+
+    std::size_t next = 0;
+    std::size_t removable = std::min(present.size(), CHURN_KEYS);
+    for (auto _ : state) {
+        if (next == removable) {
+            state.PauseTiming();
+            filter = makeFilter(config, present);
+            next = 0;
+            state.ResumeTiming();
+        }
+        benchmark::DoNotOptimize(filter->remove(present[next++]));
+    }
+    setCounters(state, *filter);
+}
+
+void parameterGrid(benchmark::internal::Benchmark *benchmark) {
+    benchmark->ArgNames({"fpr_exp", "levels", "key_length", "fill_pct"})
+             ->ArgsProduct({{2, 4}, {1, 4}, {16, 64}, {50, 100}});
+}
+
+} // namespace
+
+BENCHMARK(BM_Insert)->Apply(parameterGrid);
+BENCHMARK(BM_ContainsPositive)->Apply(parameterGrid);
+BENCHMARK(BM_ContainsNegative)->Apply(parameterGrid);
+BENCHMARK(BM_Remove)->Apply(parameterGrid);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,101 @@
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LDCF_HAVE_AVX2_PROBE 1
+#endif
+
+#include "BucketProbe.hpp"
+#include "CF.hpp"
+
+static_assert(BUCKET_SIZE == 4, "probe kernels compare one bucket per 4 lanes");
+
+uint32_t probeBucketsScalar(const char *bucket1, const char *bucket2, uint32_t fingerprint, std::size_t fingerprint_size) {
+    const Bucket first{const_cast<char*>(bucket1)};
+    const Bucket second{const_cast<char*>(bucket2)};
+
+    uint32_t matches = 0;
+    for (std::size_t i = 0; i < BUCKET_SIZE; i++) {
+        if (first.read(i, fingerprint_size) == fingerprint) {
+            matches |= 1U << i;
+        }
+        if (second.read(i, fingerprint_size) == fingerprint) {
+            matches |= 1U << (BUCKET_SIZE + i);
+        }
+    }
+
+    return matches & (first.occupancy(fingerprint_size) | (second.occupancy(fingerprint_size) << BUCKET_SIZE));
+}
+
+#ifdef LDCF_HAVE_AVX2_PROBE
+
+namespace {
+
+// Byte offset and bit shift of every slot, they only depend on the fingerprint size
+struct SlotLayout {
+    alignas(16) int32_t offsets[BUCKET_SIZE];
+    alignas(32) int64_t shifts[BUCKET_SIZE];
+};
+
+struct SlotLayouts {
+    SlotLayout layouts[BYTE_SIZE * 4 + 1];
+
+    SlotLayouts() : layouts() {
+        for (std::size_t fingerprint_size = 0; fingerprint_size <= BYTE_SIZE * 4; fingerprint_size++) {
+            for (std::size_t i = 0; i < BUCKET_SIZE; i++) {
+                auto bit_offset = i * fingerprint_size;
+                layouts[fingerprint_size].offsets[i] = static_cast<int32_t>(bit_offset / BYTE_SIZE);
+                layouts[fingerprint_size].shifts[i] = static_cast<int64_t>(bit_offset % BYTE_SIZE);
+            }
+        }
+    }
+};
+
+const SlotLayouts slot_layouts;
+
+} // namespace
+
+__attribute__((target("avx2")))
+uint32_t probeBucketsAVX2(const char *bucket1, const char *bucket2, uint32_t fingerprint, std::size_t fingerprint_size) {
+    const auto &layout = slot_layouts.layouts[fingerprint_size];
+    const __m128i offsets = _mm_load_si128(reinterpret_cast<const __m128i*>(layout.offsets));
+    const __m256i shifts = _mm256_load_si256(reinterpret_cast<const __m256i*>(layout.shifts));
+    const __m256i mask = _mm256_set1_epi64x(static_cast<long long>((1ULL << fingerprint_size) - 1));
+    const __m256i needle = _mm256_set1_epi64x(fingerprint);
+
+    // lane i holds the 8 bytes starting at the byte of slot i, like Bucket::read
+    __m256i slots1 = _mm256_i32gather_epi64(reinterpret_cast<const long long*>(bucket1), offsets, 1);
+    __m256i slots2 = _mm256_i32gather_epi64(reinterpret_cast<const long long*>(bucket2), offsets, 1);
+    slots1 = _mm256_and_si256(_mm256_srlv_epi64(slots1, shifts), mask);
+    slots2 = _mm256_and_si256(_mm256_srlv_epi64(slots2, shifts), mask);
+
+    auto matches1 = static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(slots1, needle))));
+    auto matches2 = static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(slots2, needle))));
+
+    const Bucket first{const_cast<char*>(bucket1)};
+    const Bucket second{const_cast<char*>(bucket2)};
+    auto occupied = first.occupancy(fingerprint_size) | (second.occupancy(fingerprint_size) << BUCKET_SIZE);
+
+    return (matches1 | (matches2 << BUCKET_SIZE)) & occupied;
+}
+
+ProbeFunction selectProbe() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return probeBucketsAVX2;
+    }
+    return probeBucketsScalar;
+}
+
+#else
+
+uint32_t probeBucketsAVX2(const char *bucket1, const char *bucket2, uint32_t fingerprint, std::size_t fingerprint_size) {
+    return probeBucketsScalar(bucket1, bucket2, fingerprint, fingerprint_size);
+}
+
+ProbeFunction selectProbe() {
+    return probeBucketsScalar;
+}
+
+#endif
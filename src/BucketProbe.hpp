@@ -0,0 +1,36 @@
+#ifndef BUCKET_PROBE_HPP
+#define BUCKET_PROBE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Probe kernel
+ * Compares a fingerprint against every slot of both candidate buckets at once
+ * @param bucket1 Bytes of the first bucket
+ * @param bucket2 Bytes of the second bucket
+ * @param fingerprint Fingerprint to look for, already shifted to the node's level
+ * @param fingerprint_size Size of the stored fingerprints in bits
+ * @return Match mask, bit i is slot i of bucket1 and bit BUCKET_SIZE + i is slot i of bucket2,
+ *         only occupied slots can match
+ */
+using ProbeFunction = uint32_t (*)(const char *bucket1, const char *bucket2, uint32_t fingerprint, std::size_t fingerprint_size);
+
+/**
+ * Portable probe, reads the slots one by one
+ */
+uint32_t probeBucketsScalar(const char *bucket1, const char *bucket2, uint32_t fingerprint, std::size_t fingerprint_size);
+
+/**
+ * AVX2 probe, extracts the slots of a bucket with one gather and compares them in one instruction
+ * Only call it if the CPU supports AVX2
+ */
+uint32_t probeBucketsAVX2(const char *bucket1, const char *bucket2, uint32_t fingerprint, std::size_t fingerprint_size);
+
+/**
+ * Pick the fastest probe the running CPU supports
+ * @return The AVX2 probe if available, otherwise the scalar one
+ */
+ProbeFunction selectProbe();
+
+#endif // BUCKET_PROBE_HPP
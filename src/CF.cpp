@@ -1,227 +1,378 @@
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <functional>
 #include <optional>
+#include <stdexcept>
 #include <string>
 #include <cstring>
 #include <iostream>
+#include <new>
 
 #include  "CF.hpp"
+#include "Instrumentation.hpp"
 
 // Constructor
-CuckooFilter::CuckooFilter(std::size_t number_of_buckets, std::size_t fingerprint_size, int current_level):
-    child0(nullptr), child1(nullptr), number_of_buckets(nextPowerOfTwo(number_of_buckets)), fingerprint_size(fingerprint_size), 
-    current_size(0), accept_values(true), current_level(current_level) {
-        buckets.reserve(this->number_of_buckets);
-        
+template <typename HashPolicy>
+BasicCuckooFilter<HashPolicy>::BasicCuckooFilter(std::size_t number_of_buckets, std::size_t fingerprint_size, int current_level):
+    current_level(current_level), child0(nullptr), child1(nullptr), number_of_buckets(nextPowerOfTwo(number_of_buckets)),
+    fingerprint_size(fingerprint_size), current_size(0), accept_values(true), owns_storage(true), probe(selectProbe()), version(0),
+    stash_count(0), random_state(0x9E3779B97F4A7C15ULL ^ (static_cast<uint64_t>(current_level + 1) * 0xBF58476D1CE4E5B9ULL)) {
         if (this->fingerprint_size < 1) {
             this->fingerprint_size = 1;
         }
 
-        full_slots.reserve(this->number_of_buckets * BUCKET_SIZE);
+        // fingerprints and occupancy bits share the bucket, a zeroed bucket is empty
+        bytes_per_bucket = Bucket::bytesPerBucket(this->fingerprint_size - current_level);
 
-        // Initialize the empty slots to false
-        for (std::size_t i = 0; i < this->number_of_buckets * BUCKET_SIZE; i++) {
-            full_slots.push_back(false);
+        kernels = kernelsFor(this->fingerprint_size - current_level,
+                             prefersCompiledKernels(this->fingerprint_size - current_level, probe));
+
+        storage_size = slabSize(number_of_buckets, fingerprint_size, current_level);
+        storage = static_cast<char*>(::operator new(storage_size, std::align_val_t(CACHE_LINE_SIZE)));
+        memset(storage, 0, storage_size);
+        for (auto &entry : stash) {
+            entry.store(0, std::memory_order_relaxed);
         }
+    }
 
-        auto bits_per_bucket = BUCKET_SIZE * (this->fingerprint_size - current_level); 
-        
-        // NOLINTNEXTLINE
-        auto bytes_per_bucket = (bits_per_bucket + 7) >> 3;
-        if (bytes_per_bucket == 0) {
-            bytes_per_bucket = 1;
+// Constructor over a saved slab
+template <typename HashPolicy>
+BasicCuckooFilter<HashPolicy>::BasicCuckooFilter(std::size_t number_of_buckets, std::size_t fingerprint_size, int current_level,
+                                                 const char *slab, std::size_t current_size, bool accept_values, bool copy):
+    current_level(current_level), child0(nullptr), child1(nullptr), number_of_buckets(nextPowerOfTwo(number_of_buckets)),
+    fingerprint_size(std::max<std::size_t>(fingerprint_size, 1)), current_size(current_size), accept_values(accept_values), owns_storage(copy),
+    probe(selectProbe()), version(0), stash_count(0),
+    random_state(0x9E3779B97F4A7C15ULL ^ (static_cast<uint64_t>(current_level + 1) * 0xBF58476D1CE4E5B9ULL)) {
+        bytes_per_bucket = Bucket::bytesPerBucket(this->fingerprint_size - current_level);
+        kernels = kernelsFor(this->fingerprint_size - current_level,
+                             prefersCompiledKernels(this->fingerprint_size - current_level, probe));
+        storage_size = slabSize(number_of_buckets, fingerprint_size, current_level);
+        for (auto &entry : stash) {
+            entry.store(0, std::memory_order_relaxed);
         }
-        for (std::size_t i = 0; i < this->number_of_buckets; i++) {
-            // NOLINTNEXTLINE
-            buckets[i].bit_array = new char[bytes_per_bucket]; // Allocate memory for the bucket
-            // 0 out the bucket
-            memset(buckets[i].bit_array, 0, bytes_per_bucket);
+        if (copy) {
+            storage = static_cast<char*>(::operator new(storage_size, std::align_val_t(CACHE_LINE_SIZE)));
+            memcpy(storage, slab, storage_size);
+        } else {
+            // the caller keeps the slab alive, a mapped one read-only
+            storage = const_cast<char*>(slab);
         }
     }
 
+// Constructor over a zeroed slab owned by the caller
+template <typename HashPolicy>
+BasicCuckooFilter<HashPolicy>::BasicCuckooFilter(std::size_t number_of_buckets, std::size_t fingerprint_size, int current_level, char *slab):
+    BasicCuckooFilter(number_of_buckets, fingerprint_size, current_level, slab, 0, true, false) {}
+
+// Bytes of the bucket slab of a node
+template <typename HashPolicy>
+std::size_t BasicCuckooFilter<HashPolicy>::slabSize(std::size_t number_of_buckets, std::size_t fingerprint_size, int current_level) {
+    fingerprint_size = std::max<std::size_t>(fingerprint_size, 1);
+
+    // one allocation for the whole node, Bucket::read/write load 8 bytes at a time
+    // so the slab is padded to let the last bucket be read without running off the end
+    auto size = nextPowerOfTwo(number_of_buckets) * Bucket::bytesPerBucket(fingerprint_size - current_level) + sizeof(uint64_t);
+    return (size + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+}
+
 // Destructor
-CuckooFilter::~CuckooFilter() {
-    delete child0; 
-    delete child1;
-    
-    for (std::size_t i = 0; i < number_of_buckets; ++i) {
-        // NOLINTNEXTLINE
-        delete[] buckets[i].bit_array;
+template <typename HashPolicy>
+BasicCuckooFilter<HashPolicy>::~BasicCuckooFilter() {
+    if (owns_storage) {
+        ::operator delete(storage, std::align_val_t(CACHE_LINE_SIZE));
     }
 }
 
-// Insert an item into the filter
-std::optional<Victim> CuckooFilter::insert(const std::string &item, std::optional<uint32_t> given_fingerprint) {
-    
-    if (current_size >= capacity()) {
+// Insert a hashed key into the filter
+template <typename HashPolicy>
+std::optional<Victim> BasicCuckooFilter<HashPolicy>::insert(const HashedKey &key) {
+    LDCF_COUNT(INSERTS, 1);
+
+    if (size() >= capacity()) {
         return std::nullopt;
     }
 
-    uint32_t index1 = hash(item) % number_of_buckets;
-    uint32_t fingerprint;
-
-    // If the fingerprint is given, use it, otherwise generate a new one 
-    // -> with this we want to reduce the number of hash calls which are expensive
-    if (given_fingerprint.has_value()){
-        fingerprint = given_fingerprint.value();
-    } else {
-        fingerprint = hash(item);
-        fingerprint = fingerprint & ((1 << fingerprint_size) - 1);
-    }
+    // the key was hashed once by the caller, only the fingerprint is rehashed for the alternate bucket
+    uint32_t index1 = key.index(number_of_buckets);
+    uint32_t fingerprint = key.fingerprint;
 
     uint32_t index2 = (index1 ^ hash(fingerprint)) % number_of_buckets;
 
-    // save f - current_level bits from the fingerprint
-    uint32_t saved_bits = fingerprint & ((1 << current_level) - 1);
+    // check how many of given fingerprint we already have in the buckets and the stash
+    auto matches = probeBuckets(index1, index2, fingerprint >> current_level);
+    auto counter = static_cast<std::size_t>(__builtin_popcount(matches));
+    if (stash_count.load(std::memory_order_relaxed) != 0) {
+        counter += countStashed(index1, index2, fingerprint);
+    }
+    LDCF_RECORD(DUPLICATE_MATCHES, counter);
 
-    // now we take f - current_level bits from the fingerprint
-    fingerprint >>= current_level;
+    if (counter >= BUCKET_SIZE) {
+        LDCF_COUNT(DUPLICATE_REJECTS, 1);
+        return std::nullopt;
+    }
 
-    uint32_t index_to_use = index1;
+    // unreduced, a victim keeps the bucket bits of children larger than this node
+    beginWrite();
+    auto victim = place(static_cast<uint32_t>(key.hash >> 32), fingerprint);
+    if (victim.has_value() && stashVictim(victim.value())) {
+        victim.reset();
+    }
+    endWrite();
+    LDCF_COUNT(INSERT_VICTIMS, victim.has_value() ? 1 : 0);
+    return victim;
+}
 
-    auto current_level_fingerprint_size = fingerprint_size - current_level;
+// Insert victim
+template <typename HashPolicy>
+std::optional<Victim> BasicCuckooFilter<HashPolicy>::insert(const Victim& victim) {
+    LDCF_COUNT(VICTIM_INSERTS, 1);
+    beginWrite();
+    auto next = place(victim.index, victim.fingerprint);
+    if (next.has_value() && stashVictim(next.value())) {
+        next.reset();
+    }
+    endWrite();
+    return next;
+}
 
-    // check how many of given fingerprint we already have in the buckets
-    std::size_t counter = 0;
-    for (std::size_t i = 0; i < BUCKET_SIZE; i++) {
-        if (full_slots[index1 * BUCKET_SIZE + i]) {
-            auto result1 = buckets[index1].read(i, current_level_fingerprint_size);
-            if (result1 == fingerprint) {
-                counter++;
-            }
-        }
-        if (full_slots[index2 * BUCKET_SIZE + i]) {
-            auto result2 = buckets[index2].read(i, current_level_fingerprint_size);
-            if (result2 == fingerprint) {
-                counter++;
-            }
+// Stash a victim while there is room, a full stash stops the node from accepting values
+template <typename HashPolicy>
+bool BasicCuckooFilter<HashPolicy>::stashVictim(const Victim &victim) {
+    auto count = stash_count.load(std::memory_order_relaxed);
+    if (count >= STASH_SIZE) {
+        accept_values.store(false, std::memory_order_relaxed);
+        return false;
+    }
+    auto index = static_cast<uint64_t>(victim.index & (number_of_buckets - 1));
+    stash[count].store((index << 32) | victim.fingerprint, std::memory_order_relaxed);
+    stash_count.store(count + 1, std::memory_order_relaxed);
+    LDCF_COUNT(STASHED, 1);
+    return true;
+}
+
+// Linear scan, the stash is a handful of entries and empty in most nodes
+template <typename HashPolicy>
+std::size_t BasicCuckooFilter<HashPolicy>::findStashed(std::size_t index1, std::size_t index2, uint32_t fingerprint) const {
+    auto count = std::min<std::size_t>(stash_count.load(std::memory_order_relaxed), STASH_SIZE);
+    for (std::size_t i = 0; i < count; i++) {
+        auto entry = stash[i].load(std::memory_order_relaxed);
+        auto index = static_cast<std::size_t>(entry >> 32);
+        if (static_cast<uint32_t>(entry) == fingerprint && (index == index1 || index == index2)) {
+            return i;
         }
     }
+    return STASH_SIZE;
+}
 
-    if (counter >= BUCKET_SIZE) {
-        return std::nullopt;
+// Same scan as findStashed, over every entry
+template <typename HashPolicy>
+std::size_t BasicCuckooFilter<HashPolicy>::countStashed(std::size_t index1, std::size_t index2, uint32_t fingerprint) const {
+    auto count = std::min<std::size_t>(stash_count.load(std::memory_order_relaxed), STASH_SIZE);
+    std::size_t copies = 0;
+    for (std::size_t i = 0; i < count; i++) {
+        auto entry = stash[i].load(std::memory_order_relaxed);
+        auto index = static_cast<std::size_t>(entry >> 32);
+        copies += static_cast<uint32_t>(entry) == fingerprint && (index == index1 || index == index2) ? 1 : 0;
     }
+    return copies;
+}
 
-    for (std::size_t i = 0; i < BUCKET_SIZE; i++) {
-        if (!full_slots[index_to_use * BUCKET_SIZE + i]) {
-            buckets[index_to_use].write(i, fingerprint, current_level_fingerprint_size);
-            full_slots[index_to_use * BUCKET_SIZE + i] = true;
-            current_size++;
-            return std::nullopt;
+// Retry every stashed fingerprint, the ones that still find no path stay
+template <typename HashPolicy>
+void BasicCuckooFilter<HashPolicy>::drainStash() {
+    auto count = stash_count.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < count;) {
+        auto entry = stash[i].load(std::memory_order_relaxed);
+        if (place(static_cast<uint32_t>(entry >> 32), static_cast<uint32_t>(entry)).has_value()) {
+            i++;
+            continue;
         }
+        stash[i].store(stash[--count].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        LDCF_COUNT(STASH_DRAINS, 1);
     }
-    uint32_t index_of_victim = index_to_use;
-    for (std::size_t i = 0; i < MAX_KICKS; i++) {
-        std::size_t bucket_index = rand() % BUCKET_SIZE;
-        std::uint32_t temp_fingerprint = buckets[index_to_use].read(bucket_index, current_level_fingerprint_size);
-        if (i != 0) {
-            fingerprint >>= current_level;
-        }
+    stash_count.store(count, std::memory_order_relaxed);
+}
 
-        buckets[index_to_use].write(bucket_index, fingerprint, current_level_fingerprint_size);
+// Store a full fingerprint in one of its buckets, moving other fingerprints along the shortest path to a free slot
+template <typename HashPolicy>
+template <unsigned Bits>
+std::optional<Victim> BasicCuckooFilter<HashPolicy>::placeWith(uint32_t index_to_use, uint32_t fingerprint) {
+    // save f - current_level bits from the fingerprint, every fingerprint in the node shares them
+    uint32_t saved_bits = fingerprint & ((1 << current_level) - 1);
+    uint32_t full_fingerprint = fingerprint;
 
-        fingerprint = temp_fingerprint;
+    // now we take f - current_level bits from the fingerprint
+    fingerprint >>= current_level;
 
-        fingerprint <<= current_level;
-        fingerprint |= saved_bits;
+    const SlotOps<Bits> slots{fingerprint_size - current_level};
 
-        index_of_victim = index_to_use;
+    // the alternate bucket is computed from the full fingerprint
+    auto alternate = [&](uint32_t index, uint32_t stored) {
+        return static_cast<uint32_t>((index ^ hash((stored << current_level) | saved_bits)) % number_of_buckets);
+    };
+    auto freeSlot = [&](uint32_t index) -> int {
+        for (std::size_t i = 0; i < BUCKET_SIZE; i++) {
+            if (!slots.isOccupied(bucket(index).bit_array, i)) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    };
+    auto load = [&](uint32_t index) {
+        int used = 0;
+        for (std::size_t i = 0; i < BUCKET_SIZE; i++) {
+            used += slots.isOccupied(bucket(index).bit_array, i) ? 1 : 0;
+        }
+        return used;
+    };
+
+    // the emptier bucket takes the fingerprint, the first one on a tie
+    auto index1 = static_cast<uint32_t>(index_to_use & (number_of_buckets - 1));
+    uint32_t index2 = alternate(index1, fingerprint);
+    auto target = load(index2) < load(index1) ? index2 : index1;
+    auto free = freeSlot(target);
+    if (free >= 0) {
+        slots.write(bucket(target).bit_array, free, fingerprint);
+        slots.setOccupied(bucket(target).bit_array, free, true);
+        current_size.store(current_size.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        LDCF_RECORD(PATH_LENGTH, 0);
+        return std::nullopt;
+    }
 
-        index_to_use = (index_to_use ^ hash(fingerprint)) % number_of_buckets;
+    // breadth first over full buckets, an entry's fingerprint in slot from_slot of its parent moves into it
+    struct PathEntry {
+        uint32_t index;
+        int16_t parent;
+        uint8_t from_slot;
+        uint8_t length;
+    };
+    PathEntry queue[MAX_PATH_BUCKETS];
+    int tail = 0;
+    queue[tail++] = PathEntry{index1, -1, 0, 0};
+    if (index2 != index1) {
+        queue[tail++] = PathEntry{index2, -1, 0, 0};
+    }
+    // a bucket already on the path would have a slot moved twice
+    auto onPath = [&](int entry, uint32_t index) {
+        for (; entry >= 0; entry = queue[entry].parent) {
+            if (queue[entry].index == index) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    auto first_slot = nextRandom() % BUCKET_SIZE;
+    for (int head = 0; head < tail; head++) {
+        const auto entry = queue[head];
+        for (std::size_t k = 0; k < BUCKET_SIZE; k++) {
+            auto slot = (first_slot + k) % BUCKET_SIZE;
+            auto moved = slots.read(bucket(entry.index).bit_array, slot);
+            auto next = alternate(entry.index, moved);
+            auto next_free = freeSlot(next);
+            if (next_free < 0) {
+                if (entry.length + 1 < MAX_PATH_LENGTH && tail < MAX_PATH_BUCKETS && !onPath(head, next)) {
+                    queue[tail++] = PathEntry{next, static_cast<int16_t>(head), static_cast<uint8_t>(slot),
+                                              static_cast<uint8_t>(entry.length + 1)};
+                }
+                continue;
+            }
 
-        for (std::size_t j = 0; j < BUCKET_SIZE; j++) {
-            if (!full_slots[index_to_use * BUCKET_SIZE + j]) {
-                fingerprint >>= current_level;
-                buckets[index_to_use].write(j, fingerprint, current_level_fingerprint_size);
-                full_slots[index_to_use * BUCKET_SIZE + j] = true;
-                current_size++;
-                return std::nullopt;
+            // carry the path out from the free end, every fingerprint is written before its old slot is reused
+            slots.write(bucket(next).bit_array, next_free, moved);
+            slots.setOccupied(bucket(next).bit_array, next_free, true);
+            auto hole_index = entry.index;
+            auto hole_slot = slot;
+            for (int at = head; queue[at].parent >= 0; at = queue[at].parent) {
+                const auto &parent = queue[queue[at].parent];
+                slots.write(bucket(hole_index).bit_array, hole_slot, slots.read(bucket(parent.index).bit_array, queue[at].from_slot));
+                hole_index = parent.index;
+                hole_slot = queue[at].from_slot;
             }
+            slots.write(bucket(hole_index).bit_array, hole_slot, fingerprint);
+            current_size.store(current_size.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            LDCF_COUNT(RELOCATIONS, entry.length + 1);
+            LDCF_RECORD(PATH_LENGTH, entry.length + 1);
+            return std::nullopt;
         }
     }
 
-    accept_values = false;
-
-    return std::make_optional(Victim{fingerprint, index_of_victim});
+    // no path, the node is unchanged and the new fingerprint goes to the stash or a child
+    return std::make_optional(Victim{full_fingerprint, index_to_use});
 }
 
-// Insert victim
-void CuckooFilter::insert(const Victim& victim) {
-    // now we take f - current_level bits from the fingerprint
-    uint32_t fingerprint = victim.fingerprint;
-
-    uint32_t index1 = victim.index;
-    fingerprint >>= current_level;
-
-    uint32_t index_to_use = index1;
+// Probe both candidate buckets with the kernel for the node's fingerprint width
+template <typename HashPolicy>
+template <unsigned Bits>
+uint32_t BasicCuckooFilter<HashPolicy>::probeWith(std::size_t index1, std::size_t index2, uint32_t fingerprint) const {
+    if constexpr (Bits == 0) {
+        return probe(bucket(index1).bit_array, bucket(index2).bit_array, fingerprint, fingerprint_size - current_level);
+    } else {
+        return FixedBucket<Bits, BUCKET_SIZE>::probe(bucket(index1).bit_array, bucket(index2).bit_array, fingerprint);
+    }
+}
 
-    auto current_level_fingerprint_size = fingerprint_size - current_level;
+// Kernels compiled for every width from MIN_SPECIALIZED_WIDTH to MAX_SPECIALIZED_WIDTH
+template <typename HashPolicy>
+template <std::size_t... Offsets>
+typename BasicCuckooFilter<HashPolicy>::Kernels BasicCuckooFilter<HashPolicy>::specializedKernels(std::size_t width, std::index_sequence<Offsets...>) {
+    static const Kernels table[] = {
+        Kernels{&BasicCuckooFilter::placeWith<MIN_SPECIALIZED_WIDTH + Offsets>,
+                &BasicCuckooFilter::probeWith<MIN_SPECIALIZED_WIDTH + Offsets>}...
+    };
+    return table[width - MIN_SPECIALIZED_WIDTH];
+}
 
-    for (std::size_t i = 0; i < BUCKET_SIZE; i++) {
-        if (!full_slots[index_to_use * BUCKET_SIZE + i]) {
-            buckets[index_to_use].write(i, fingerprint, current_level_fingerprint_size);
-            full_slots[index_to_use * BUCKET_SIZE + i] = true;
-            current_size++;
-            return;
-        }
+// Pick the kernels for the width a node stores, it shrinks by one bit per level
+template <typename HashPolicy>
+typename BasicCuckooFilter<HashPolicy>::Kernels BasicCuckooFilter<HashPolicy>::kernelsFor(std::size_t width, bool specialized) {
+    if (specialized && width >= MIN_SPECIALIZED_WIDTH && width <= MAX_SPECIALIZED_WIDTH) {
+        return specializedKernels(width, std::make_index_sequence<MAX_SPECIALIZED_WIDTH - MIN_SPECIALIZED_WIDTH + 1>{});
     }
+    return Kernels{&BasicCuckooFilter::placeWith<0>, &BasicCuckooFilter::probeWith<0>};
+}
 
-    // we should not be here
-    throw std::runtime_error("Victim could not be inserted");
+// The compiled kernels read 8, 16 and 32 bit slots as whole bytes and tie the AVX2 gather there, at the other
+// widths they trail it, so they are only the default at those widths or when the CPU has no AVX2
+template <typename HashPolicy>
+bool BasicCuckooFilter<HashPolicy>::prefersCompiledKernels(std::size_t width, ProbeFunction probe) {
+    return width == 8 || width == 16 || width == 32 || probe == probeBucketsScalar;
 }
 
-bool CuckooFilter::contains(const std::string &item, std::optional<uint32_t> given_fingerprint) const {
-    std::size_t index1 = hash(item) % number_of_buckets;
-    uint32_t fingerprint;
-
-    // If the fingerprint is given, use it, otherwise generate a new one
-    if (given_fingerprint.has_value()){
-        fingerprint = given_fingerprint.value();
-    } else {
-        fingerprint = hash(item);
-        fingerprint = fingerprint & ((1 << fingerprint_size) - 1);
-    }
+template <typename HashPolicy>
+bool BasicCuckooFilter<HashPolicy>::contains(const HashedKey &key) const {
+    std::size_t index1 = key.index(number_of_buckets);
+    uint32_t fingerprint = key.fingerprint;
 
     std::size_t index2 = (index1 ^ hash(fingerprint)) % number_of_buckets;
 
     // now we take f - current_level bits from the fingerprint
     fingerprint >>= current_level;
 
-    auto current_level_fingerprint_size = fingerprint_size - current_level;
+    LDCF_COUNT(NODE_PROBES, 1);
 
-    for (std::size_t i = 0; i < BUCKET_SIZE; i++) {
-        // check if those buckets are empty
-        if (full_slots[index1 * BUCKET_SIZE + i]) {
-            auto result1 = buckets[index1].read(i, current_level_fingerprint_size);
-            if (result1 == fingerprint) {
-                return true;
-            }
+    // compares all slots of both buckets, occupancy included, again if the writer changed the node meanwhile
+    while (true) {
+        auto before = version.load(std::memory_order_acquire);
+        auto matches = probeBuckets(index1, index2, fingerprint);
+        if (matches == 0 && stash_count.load(std::memory_order_relaxed) != 0) {
+            matches = findStashed(index1, index2, key.fingerprint) < STASH_SIZE ? 1 : 0;
         }
-        if (full_slots[index2 * BUCKET_SIZE + i]) {
-            auto result2 = buckets[index2].read(i, current_level_fingerprint_size);
-            if (result2 == fingerprint) {
-                return true;
-            }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((before & 1U) == 0 && version.load(std::memory_order_relaxed) == before) {
+            return matches != 0;
         }
+        LDCF_COUNT(PROBE_RETRIES, 1);
     }
-
-    return false;
 }
 
 
-bool CuckooFilter::remove(const std::string &item, std::optional<uint32_t> given_fingerprint) {
-    std::size_t index1 = hash(item) % number_of_buckets;
-    uint32_t fingerprint;
-
-    // If the fingerprint is given, use it, otherwise generate a new one
-    if (given_fingerprint.has_value()){
-        fingerprint = given_fingerprint.value();
-    } else {
-        fingerprint = hash(item);
-        fingerprint = fingerprint & ((1 << fingerprint_size) - 1);
-    }
+template <typename HashPolicy>
+bool BasicCuckooFilter<HashPolicy>::remove(const HashedKey &key) {
+    std::size_t index1 = key.index(number_of_buckets);
+    uint32_t fingerprint = key.fingerprint;
 
     std::size_t index2 = (index1 ^ hash(fingerprint)) % number_of_buckets;
 
@@ -230,47 +381,86 @@ bool CuckooFilter::remove(const std::string &item, std::optional<uint32_t> given
 
     auto current_level_fingerprint_size = fingerprint_size - current_level;
 
-    for (std::size_t i = 0; i < BUCKET_SIZE; i++) {
-        if (buckets[index1].read(i, current_level_fingerprint_size) == fingerprint && full_slots[index1 * BUCKET_SIZE + i]) {
-            full_slots[index1 * BUCKET_SIZE + i] = false; // no need to delete the fingerprint
-            current_size--;
-            return true;
-        }
-        if (buckets[index2].read(i, current_level_fingerprint_size) == fingerprint && full_slots[index2 * BUCKET_SIZE + i]) {
-            full_slots[index2 * BUCKET_SIZE + i] = false; // no need to delete the fingerprint
-            current_size--;
-            return true;
+    LDCF_COUNT(REMOVES, 1);
+    auto matches = probeBuckets(index1, index2, fingerprint);
+    if (matches == 0) {
+        auto stashed_at = findStashed(index1, index2, key.fingerprint);
+        if (stashed_at == STASH_SIZE) {
+            LDCF_COUNT(REMOVE_MISSES, 1);
+            return false;
         }
+        // the last entry takes the place of the removed one
+        auto count = stash_count.load(std::memory_order_relaxed) - 1;
+        beginWrite();
+        stash[stashed_at].store(stash[count].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        stash_count.store(count, std::memory_order_relaxed);
+        endWrite();
+        return true;
     }
 
-    return false;
+    // remove the first match, bits below BUCKET_SIZE belong to the first bucket
+    auto slot = static_cast<std::size_t>(__builtin_ctz(matches));
+    auto index_to_use = slot < BUCKET_SIZE ? index1 : index2;
+    beginWrite();
+    bucket(index_to_use).setOccupied(slot % BUCKET_SIZE, current_level_fingerprint_size, false); // no need to delete the fingerprint
+    current_size.store(current_size.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    // the freed slot may open a path for a stashed fingerprint
+    if (stash_count.load(std::memory_order_relaxed) != 0) {
+        drainStash();
+    }
+    endWrite();
+    return true;
 }
 
-std::size_t CuckooFilter::capacity() const {
+template <typename HashPolicy>
+std::size_t BasicCuckooFilter<HashPolicy>::capacity() const {
     return static_cast<std::size_t>(number_of_buckets * BUCKET_SIZE * LOAD_FACTOR);
 }
 
+// Bytes allocated by this node
+template <typename HashPolicy>
+std::size_t BasicCuckooFilter<HashPolicy>::memoryUsage() const {
+    return sizeof(BasicCuckooFilter) + storage_size;
+}
+
 // Size of the filter
-std::size_t CuckooFilter::size() const {
-    return current_size;
+template <typename HashPolicy>
+std::size_t BasicCuckooFilter<HashPolicy>::size() const {
+    return current_size.load(std::memory_order_relaxed) + stash_count.load(std::memory_order_relaxed);
 }
 
-// Check if the filter is full
-bool CuckooFilter::isFull() const {
-    return current_size >= capacity() || !accept_values;
+// Copy the stash out as victims with reduced indexes
+template <typename HashPolicy>
+std::size_t BasicCuckooFilter<HashPolicy>::stashed(Victim *entries) const {
+    auto count = std::min<std::size_t>(stash_count.load(std::memory_order_relaxed), STASH_SIZE);
+    for (std::size_t i = 0; i < count; i++) {
+        auto entry = stash[i].load(std::memory_order_relaxed);
+        entries[i] = Victim{static_cast<uint32_t>(entry), static_cast<uint32_t>(entry >> 32)};
+    }
+    return count;
 }
 
-std::size_t CuckooFilter::hash(const std::string& item) {
-    std::hash<std::string> hash_fn;
-    return hash_fn(item);
+// Refill the stash of a node rebuilt from a saved slab
+template <typename HashPolicy>
+void BasicCuckooFilter<HashPolicy>::restoreStash(const Victim *entries, std::size_t count) {
+    if (count > STASH_SIZE) {
+        throw std::runtime_error("A stash holds at most " + std::to_string(STASH_SIZE) + " fingerprints");
+    }
+    for (std::size_t i = 0; i < count; i++) {
+        auto index = static_cast<uint64_t>(entries[i].index & (number_of_buckets - 1));
+        stash[i].store((index << 32) | entries[i].fingerprint, std::memory_order_relaxed);
+    }
+    stash_count.store(static_cast<uint32_t>(count), std::memory_order_relaxed);
 }
 
-std::size_t CuckooFilter::hash(const std::size_t item) {
-    std::hash<std::size_t> hash_fn;
-    return hash_fn(item);
+// Check if the filter is full
+template <typename HashPolicy>
+bool BasicCuckooFilter<HashPolicy>::isFull() const {
+    return size() >= capacity() || !accept_values.load(std::memory_order_relaxed);
 }
 
-std::size_t CuckooFilter::nextPowerOfTwo(std::size_t n)  {
+template <typename HashPolicy>
+std::size_t BasicCuckooFilter<HashPolicy>::nextPowerOfTwo(std::size_t n)  {
     n--;
     n |= n >> 1;
     n |= n >> 2;
@@ -280,4 +470,7 @@ std::size_t CuckooFilter::nextPowerOfTwo(std::size_t n)  {
     n |= n >> BYTE_SIZE * 4;
     n++;
     return n;
-}
\ No newline at end of file
+}
+
+template class BasicCuckooFilter<StdHashPolicy>;
+template class BasicCuckooFilter<WyHashPolicy>;
@@ -1,148 +1,389 @@
 #ifndef CUCKOO_FILTER_HPP
 #define CUCKOO_FILTER_HPP
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <unordered_set>
 #include <vector>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <bitset>
+#include <cstring>
+#include <utility>
 
-const int MAX_KICKS = 100;
-const double LOAD_FACTOR = 0.935;
+#include "BucketProbe.hpp"
+#include "FixedBucket.hpp"
+#include "Hash.hpp"
+
+// Longest chain of moves the cuckoo path search tries, and the most buckets it visits
+const int MAX_PATH_LENGTH = 5;
+const int MAX_PATH_BUCKETS = 256;
+const double LOAD_FACTOR = 0.95;
 const int BUCKET_SIZE = 4;
 
+// Fingerprints a node keeps aside when no path frees a slot for them, before it hands victims to a child
+const std::size_t STASH_SIZE = 4;
+
 const int BYTE_SIZE = 8;
+const std::size_t CACHE_LINE_SIZE = 64;
+
+// Fingerprint widths with kernels compiled for them, narrower nodes use the runtime width kernels
+const unsigned MIN_SPECIALIZED_WIDTH = 4;
+const unsigned MAX_SPECIALIZED_WIDTH = 32;
 
 /**
  * Bucket item
  * Used to store fingerprints in the filter
+ * Layout: BUCKET_SIZE fingerprints of fingerprint_size bits followed by BUCKET_SIZE occupancy bits,
+ * so a probe reads the slots and their occupancy from the same few bytes
  */
 struct Bucket {
     char *bit_array;
 
+    // Number of bytes one bucket takes for the given fingerprint size
+    static std::size_t bytesPerBucket(std::size_t fingerprint_size) {
+        auto bits_per_bucket = BUCKET_SIZE * (fingerprint_size + 1);
+        return (bits_per_bucket + BYTE_SIZE - 1) / BYTE_SIZE;
+    }
+
     // Write fingerprint to the bucket
     void write(std::size_t position, uint32_t fingerprint, std::size_t fingerprint_size) const {
-        std::size_t bit_offset = position * fingerprint_size;
+        writeBits(position * fingerprint_size, fingerprint, fingerprint_size);
+    }
+
+    // Read fingerprint from the bucket
+    [[nodiscard]] uint32_t read(std::size_t position, std::size_t fingerprint_size) const {
+        return readBits(position * fingerprint_size, fingerprint_size);
+    }
+
+    // Read the occupancy bits, bit i is set if slot i holds a fingerprint
+    [[nodiscard]] uint32_t occupancy(std::size_t fingerprint_size) const {
+        return readBits(BUCKET_SIZE * fingerprint_size, BUCKET_SIZE);
+    }
+
+    // Check if the slot holds a fingerprint
+    [[nodiscard]] bool isOccupied(std::size_t position, std::size_t fingerprint_size) const {
+        return ((occupancy(fingerprint_size) >> position) & 1U) != 0;
+    }
+
+    // Mark the slot as full or empty
+    void setOccupied(std::size_t position, std::size_t fingerprint_size, bool occupied) const {
+        uint32_t bits = occupancy(fingerprint_size);
+        if (occupied) {
+            bits |= 1U << position;
+        } else {
+            bits &= ~(1U << position);
+        }
+        writeBits(BUCKET_SIZE * fingerprint_size, bits, BUCKET_SIZE);
+    }
+
+private:
+    void writeBits(std::size_t bit_offset, uint32_t value, std::size_t width) const {
         std::size_t byte_offset = bit_offset / BYTE_SIZE;
         bit_offset %= BYTE_SIZE;
 
-        uint64_t mask = (1ULL << fingerprint_size) - 1;
-        fingerprint &= mask;
+        uint64_t mask = (1ULL << width) - 1;
+        uint64_t bits = value & mask;
 
-        auto *target = reinterpret_cast<uint64_t*>(bit_array + byte_offset);
-        *target &= ~(mask << bit_offset);
-        *target |= (static_cast<uint64_t>(fingerprint) << bit_offset);
+        uint64_t word;
+        memcpy(&word, bit_array + byte_offset, sizeof(word));
+        word &= ~(mask << bit_offset);
+        word |= (bits << bit_offset);
+        memcpy(bit_array + byte_offset, &word, sizeof(word));
     }
 
-    // Read fingerprint from the bucket
-    [[nodiscard]] uint32_t read(std::size_t position, std::size_t fingerprint_size) const {
-        std::size_t bit_offset = position * fingerprint_size;
+    [[nodiscard]] uint32_t readBits(std::size_t bit_offset, std::size_t width) const {
         std::size_t byte_offset = bit_offset / BYTE_SIZE;
         bit_offset %= BYTE_SIZE;
 
-        uint64_t mask = (1ULL << fingerprint_size) - 1;
+        uint64_t mask = (1ULL << width) - 1;
 
-        const auto *target = reinterpret_cast<const uint64_t*>(bit_array + byte_offset);
-        uint64_t fingerprint = (*target >> bit_offset) & mask;
+        uint64_t word;
+        memcpy(&word, bit_array + byte_offset, sizeof(word));
+        uint64_t bits = (word >> bit_offset) & mask;
 
-        return static_cast<uint32_t>(fingerprint);
+        return static_cast<uint32_t>(bits);
+    }
+};
+
+/**
+ * Slot access of a node
+ * FixedBucket for a fingerprint width fixed at compile time, Bucket with the runtime width when Bits is 0
+ */
+template <unsigned Bits>
+struct SlotOps {
+    std::size_t width;
+
+    [[nodiscard]] uint32_t read(char *bucket, std::size_t position) const {
+        if constexpr (Bits == 0) {
+            return Bucket{bucket}.read(position, width);
+        } else {
+            return FixedBucket<Bits, BUCKET_SIZE>::read(bucket, position);
+        }
+    }
+
+    void write(char *bucket, std::size_t position, uint32_t fingerprint) const {
+        if constexpr (Bits == 0) {
+            Bucket{bucket}.write(position, fingerprint, width);
+        } else {
+            FixedBucket<Bits, BUCKET_SIZE>::write(bucket, position, fingerprint);
+        }
+    }
+
+    [[nodiscard]] bool isOccupied(char *bucket, std::size_t position) const {
+        if constexpr (Bits == 0) {
+            return Bucket{bucket}.isOccupied(position, width);
+        } else {
+            return ((FixedBucket<Bits, BUCKET_SIZE>::occupancy(bucket) >> position) & 1U) != 0;
+        }
+    }
+
+    void setOccupied(char *bucket, std::size_t position, bool occupied) const {
+        if constexpr (Bits == 0) {
+            Bucket{bucket}.setOccupied(position, width, occupied);
+        } else {
+            FixedBucket<Bits, BUCKET_SIZE>::setOccupied(bucket, position, occupied);
+        }
     }
 };
 
 /**
  * Victim item
  * Represents a victim item in the filter -> an item that was kicked out during insertion
+ * The index is one of the fingerprint's buckets before it is reduced to a node: every node masks it with its
+ * own number of buckets, a power of two, so children larger than their parent still find the key's buckets.
  */
 struct Victim {
     uint32_t fingerprint;
     uint32_t index;
 };
 
+/**
+ * Hashed key
+ * A key hashed once and carried through every level of the tree:
+ * the high 32 bits select the bucket, the low fingerprint_size bits are the fingerprint
+ * and the low bits of the fingerprint route the key to a child
+ */
+struct HashedKey {
+    uint64_t hash;
+    uint32_t fingerprint;
+
+    /**
+     * Build a key from a 64-bit hash
+     * @param hash Hash of the key, it should be well mixed
+     * @param fingerprint_size Size of the fingerprint in bits
+     * @return The key
+     */
+    static HashedKey fromHash(uint64_t hash, std::size_t fingerprint_size) {
+        auto mask = (1ULL << fingerprint_size) - 1;
+        return HashedKey{hash, static_cast<uint32_t>(hash & mask)};
+    }
+
+    /**
+     * Get the first bucket of the key
+     * @param number_of_buckets Number of buckets in the node, a power of two
+     * @return The bucket index
+     */
+    [[nodiscard]] std::size_t index(std::size_t number_of_buckets) const {
+        return (hash >> 32) & (number_of_buckets - 1);
+    }
+};
+
 /**
  * Cuckoo Filter implementation
+ * One writer and any number of concurrent readers: writes to the buckets are bracketed by a sequence
+ * counter, a reader that overlapped a write probes again. Children are published with release stores.
+ * @tparam HashPolicy Hashes keys and fingerprints, see Hash.hpp
  */
-class CuckooFilter {
+template <typename HashPolicy>
+class BasicCuckooFilter {
 public:
 
     int current_level;
 
-    CuckooFilter* child0;
-    CuckooFilter* child1;
+    std::atomic<BasicCuckooFilter*> child0;
+    std::atomic<BasicCuckooFilter*> child1;
 
     /**
      * Constructor
      * @param number_of_buckets Number of buckets in the filter
      * @param fingerprint_size Size of the fingerprint in bits
      */
-    CuckooFilter(std::size_t number_of_buckets,  std::size_t fingerprint_size, int current_level);
+    BasicCuckooFilter(std::size_t number_of_buckets,  std::size_t fingerprint_size, int current_level);
 
     /**
-     * Destructor
+     * Constructor over a bucket slab written by a saved filter
+     * @param number_of_buckets Number of buckets in the filter
+     * @param fingerprint_size Size of the fingerprint in bits
+     * @param current_level Level of the node in its tree
+     * @param slab slabSize() bytes of buckets, 64-byte aligned if it is not copied
+     * @param current_size Number of fingerprints in the slab
+     * @param accept_values False if the node stopped taking new values
+     * @param copy True to copy the slab, false to use it in place, the node must then never be modified
      */
-    ~CuckooFilter();
+    BasicCuckooFilter(std::size_t number_of_buckets, std::size_t fingerprint_size, int current_level,
+                      const char *slab, std::size_t current_size, bool accept_values, bool copy);
+
+    /**
+     * Constructor over a zeroed slab the caller owns and frees, such as a block of a tree's NodeArena
+     * @param number_of_buckets Number of buckets in the filter
+     * @param fingerprint_size Size of the fingerprint in bits
+     * @param current_level Level of the node in its tree
+     * @param slab slabSize() zeroed bytes, 64-byte aligned
+     */
+    BasicCuckooFilter(std::size_t number_of_buckets, std::size_t fingerprint_size, int current_level, char *slab);
+
+    /**
+     * Destructor, frees the slab if the node owns it; children belong to the tree that created them
+     */
+    ~BasicCuckooFilter();
 
     /**
      * Copy constructor
-     * @param other The CuckooFilter object to copy from
+     * @param other The filter to copy from
      */
-    CuckooFilter(const CuckooFilter& other);
+    BasicCuckooFilter(const BasicCuckooFilter& other);
 
     /**
      * Copy assignment operator
-     * @param other The CuckooFilter object to assign from
+     * @param other The filter to assign from
      * @return Reference to the assigned CuckooFilter object
      */
-    CuckooFilter& operator=(const CuckooFilter& other);
+    BasicCuckooFilter& operator=(const BasicCuckooFilter& other);
 
     /**
      * Move constructor
-     * @param other The CuckooFilter object to move from
+     * @param other The filter to move from
      */
-    CuckooFilter(CuckooFilter&& other) noexcept ;
+    BasicCuckooFilter(BasicCuckooFilter&& other) noexcept ;
 
     /**
      * Move assignment operator
-     * @param other The CuckooFilter object to move assign from
+     * @param other The filter to move assign from
      * @return Reference to the moved CuckooFilter object
      */
-    CuckooFilter& operator=(CuckooFilter&& other) noexcept ;
+    BasicCuckooFilter& operator=(BasicCuckooFilter&& other) noexcept ;
 
     /**
      * Insert an item into the filter
      * @param item Item to insert
      * @return std::nullopt if the filter is full, otherwise the victim item and its index
      */
-    std::optional<Victim> insert(const std::string &item, std::optional<uint32_t> given_fingerprint = std::nullopt);
+    std::optional<Victim> insert(std::string_view item) { return insert(hashKey(item)); }
 
     /**
-     * Check if an item is in the filter
-     * @param victim victim to insert
+     * Insert a byte range into the filter
+     * @param data First byte of the item
+     * @param length Number of bytes
+     * @return std::nullopt if the filter is full, otherwise the victim item and its index
+     */
+    std::optional<Victim> insert(const void *data, std::size_t length) { return insert(toView(data, length)); }
+
+    /**
+     * Insert a hashed key into the filter
+     * @param key Key to insert
+     * @return std::nullopt if the key was stored or the filter is full, otherwise the key's fingerprint
+     *         and the unreduced first bucket, the high 32 bits of its hash, as a victim for a child; the node
+     *         is left as it was. A key no path makes room for goes to the stash first, victims only come once
+     *         it is full.
      */
-    void insert(const Victim &victim);
+    std::optional<Victim> insert(const HashedKey &key);
+
+    /**
+     * Insert a victim kicked out of another node, starting at the bucket it came from
+     * @param victim Victim to insert
+     * @return std::nullopt if it was stored in a bucket or the stash, otherwise the victim, the node is left as it was
+     */
+    std::optional<Victim> insert(const Victim &victim);
 
     /**
      * Check if an item is in the filter
      * @param item Item to check
      * @return True if the item is in the filter, false otherwise
      */
-    [[nodiscard]] bool contains(const std::string &item, std::optional<uint32_t> given_fingerprint = std::nullopt) const;
+    [[nodiscard]] bool contains(std::string_view item) const { return contains(hashKey(item)); }
+
+    /**
+     * Check if a byte range is in the filter
+     * @param data First byte of the item
+     * @param length Number of bytes
+     * @return True if the item is in the filter, false otherwise
+     */
+    [[nodiscard]] bool contains(const void *data, std::size_t length) const { return contains(toView(data, length)); }
+
+    /**
+     * Check if a hashed key is in the filter
+     * @param key Key to check
+     * @return True if the key is in the filter, false otherwise
+     */
+    [[nodiscard]] bool contains(const HashedKey &key) const;
 
     /**
      * Remove an item from the filter
      * @param item Item to remove
      * @return True if the item was removed, false otherwise
      */
-    bool remove(const std::string &item, std::optional<uint32_t> given_fingerprint = std::nullopt);
+    bool remove(std::string_view item) { return remove(hashKey(item)); }
+
+    /**
+     * Remove a byte range from the filter
+     * @param data First byte of the item
+     * @param length Number of bytes
+     * @return True if the item was removed, false otherwise
+     */
+    bool remove(const void *data, std::size_t length) { return remove(toView(data, length)); }
+
+    /**
+     * Remove a hashed key from the filter, from a bucket or the stash
+     * A slot freed in a bucket is offered to the stashed fingerprints first.
+     * @param key Key to remove
+     * @return True if the key was removed, false otherwise
+     */
+    bool remove(const HashedKey &key);
+
+    /**
+     * Prefetch both candidate buckets of a key
+     * @param key Key that will be probed next
+     */
+    void prefetch(const HashedKey &key) const {
+        auto index1 = key.index(number_of_buckets);
+        auto index2 = (index1 ^ hash(key.fingerprint)) % number_of_buckets;
+        __builtin_prefetch(storage + index1 * bytes_per_bucket);
+        __builtin_prefetch(storage + index2 * bytes_per_bucket);
+    }
+
+    /**
+     * Hash an item into a key for this filter's fingerprint size
+     * @param item Item to hash
+     * @return The hashed key
+     */
+    [[nodiscard]] HashedKey hashKey(std::string_view item) const {
+        return HashedKey::fromHash(HashPolicy::hash(item), fingerprint_size);
+    }
 
     /**
      * Get the filter's size
-     * @return The number of items in the filter
+     * @return The number of items in the filter, stashed ones included
      */
     [[nodiscard]] std::size_t size() const;
 
+    /**
+     * Get the stashed fingerprints
+     * @param entries Filled with up to STASH_SIZE victims: the full fingerprint and one of its buckets
+     * @return The number of stashed fingerprints
+     */
+    std::size_t stashed(Victim *entries) const;
+
+    /**
+     * Put saved fingerprints back into an empty stash
+     * @param entries Victims as returned by stashed
+     * @param count How many, at most STASH_SIZE
+     */
+    void restoreStash(const Victim *entries, std::size_t count);
+
     /**
      * Get the filter's capacity
      * @return The maximum number of items the filter can hold
@@ -156,7 +397,19 @@ public:
     [[nodiscard]] std::size_t getFingerprintSize() const { return fingerprint_size; }
 
     /**
-     * Check if the filter is full
+     * Get the filter's number of buckets
+     * @return The number of buckets, a power of two
+     */
+    [[nodiscard]] std::size_t getNumberOfBuckets() const { return number_of_buckets; }
+
+    /**
+     * Get the number of bytes the filter allocates
+     * @return Bytes used by the node header and the bucket slab
+     */
+    [[nodiscard]] std::size_t memoryUsage() const;
+
+    /**
+     * Check if the filter is full, safe while another thread inserts into it
      * @return True if the filter is full, false otherwise
      */
     [[nodiscard]] bool isFull() const;
@@ -165,33 +418,237 @@ public:
      * Accept values
      * @param accept True if the filter should accept values, false otherwise
      */
-    void acceptValues(bool accept) { accept_values = accept; }
+    void acceptValues(bool accept) { accept_values.store(accept, std::memory_order_relaxed); }
+
+    /**
+     * Override the kernels picked for the node's fingerprint width
+     * @param specialized True to use the kernels compiled for the width, false to use the runtime width ones
+     */
+    void specializeKernels(bool specialized) { kernels = kernelsFor(fingerprint_size - current_level, specialized); }
+
+    /**
+     * Check which kernels the node uses
+     * @return True if it uses the kernels compiled for its width, false for the runtime width ones
+     */
+    [[nodiscard]] bool usesCompiledKernels() const { return kernels.probe != &BasicCuckooFilter::probeWith<0>; }
+
+    /**
+     * Check if the filter still takes new values, it stops after a kick chain fails
+     * @return True if the filter accepts values
+     */
+    [[nodiscard]] bool acceptsValues() const { return accept_values.load(std::memory_order_relaxed); }
+
+    /**
+     * Visit every fingerprint the node holds, stashed ones last
+     * @param visit Called with the bucket index and the fingerprint as stored, without the low current_level bits
+     */
+    template <typename Visit>
+    void forEachFingerprint(Visit &&visit) const {
+        auto width = fingerprint_size - current_level;
+        for (std::size_t i = 0; i < number_of_buckets; i++) {
+            auto occupied = bucket(i).occupancy(width);
+            for (std::size_t slot = 0; slot < BUCKET_SIZE; slot++) {
+                if (((occupied >> slot) & 1U) != 0) {
+                    visit(i, bucket(i).read(slot, width));
+                }
+            }
+        }
+        Victim entries[STASH_SIZE];
+        auto count = stashed(entries);
+        for (std::size_t i = 0; i < count; i++) {
+            visit(entries[i].index, entries[i].fingerprint >> current_level);
+        }
+    }
+
+    /**
+     * Get the bucket slab, as saved to disk
+     * @return slabSize() bytes
+     */
+    [[nodiscard]] const char *data() const { return storage; }
+
+    /**
+     * Get the number of bytes of the bucket slab
+     * @param number_of_buckets Number of buckets, rounded up to a power of two
+     * @param fingerprint_size Size of the full fingerprint in bits
+     * @param current_level Level of the node, it stores fingerprint_size - current_level bits
+     * @return Size of the slab, a multiple of CACHE_LINE_SIZE
+     */
+    static std::size_t slabSize(std::size_t number_of_buckets, std::size_t fingerprint_size, int current_level);
 
     /**
      * Hash a string
      * @param item The string to hash
      * @return The hash of the string
      */
-    static std::size_t hash(const std::string& item) ;
+    static std::size_t hash(std::string_view item) { return HashPolicy::hash(item); }
 
     /**
      * Hash a size_t
      * @param item The size_t to hash
      * @return The hash of the size_t
      */
-    static std::size_t hash(std::size_t item) ;
+    static std::size_t hash(std::size_t item) { return HashPolicy::hash(static_cast<uint64_t>(item)); }
 
 private:
     std::size_t number_of_buckets;
     std::size_t fingerprint_size;
     std::size_t max_kicks;
-    std::size_t current_size;
+    // atomic so insert_parallel can check isFull on a node another thread writes, only the writer changes them
+    std::atomic<std::size_t> current_size;
+    std::atomic<bool> accept_values;
+
+    // all buckets live in one cache line aligned slab, bucket i starts at i * bytes_per_bucket
+    char *storage;
+    std::size_t bytes_per_bucket;
+    std::size_t storage_size;
+
+    // false if storage points into a mapped file
+    bool owns_storage;
+
+    // bucket compare kernel picked for the running CPU, for the runtime width path
+    ProbeFunction probe;
+
+    /**
+     * Insert and probe kernels of one fingerprint width
+     */
+    struct Kernels {
+        std::optional<Victim> (BasicCuckooFilter::*place)(uint32_t, uint32_t);
+        uint32_t (BasicCuckooFilter::*probe)(std::size_t, std::size_t, uint32_t) const;
+    };
+
+    // picked by width when the node is built, every level of a tree stores one bit less
+    Kernels kernels;
+
+    // sequence counter, odd while the writer is changing the buckets or the stash
+    std::atomic<uint32_t> version;
+
+    // fingerprints no cuckoo path found room for, entry i < stash_count is (bucket << 32) | full fingerprint;
+    // atomics because probes read them while the writer changes them, the version tells them to retry
+    std::atomic<uint32_t> stash_count;
+    std::atomic<uint64_t> stash[STASH_SIZE];
+
+    // xorshift state for picking the slot the path search starts at, per node so concurrent builders never share it
+    uint64_t random_state;
+
+    /**
+     * Get the next pseudo random number of this node
+     * @return xorshift64* output
+     */
+    uint64_t nextRandom() {
+        random_state ^= random_state >> 12;
+        random_state ^= random_state << 25;
+        random_state ^= random_state >> 27;
+        return random_state * 0x2545F4914F6CDD1DULL;
+    }
+
+    /**
+     * Store a fingerprint in the emptier of its two buckets, moving others between their buckets if both are full
+     * The shortest chain of moves to a free slot is found first and then carried out from its free end,
+     * so no fingerprint the node already held is ever missing, not even for a moment between this node and a child.
+     * Nothing is moved if there is no chain within MAX_PATH_LENGTH moves and MAX_PATH_BUCKETS buckets.
+     * @param index_to_use One of the fingerprint's buckets, unreduced or reduced to a node at least as large
+     * @param fingerprint Full fingerprint, the node keeps the bits above current_level
+     * @return std::nullopt if it was stored, otherwise the fingerprint itself, for the stash or a child
+     */
+    std::optional<Victim> place(uint32_t index_to_use, uint32_t fingerprint) { return (this->*kernels.place)(index_to_use, fingerprint); }
 
-    bool accept_values;
+    /**
+     * place for a width fixed at compile time, or the node's runtime width when Bits is 0
+     */
+    template <unsigned Bits>
+    std::optional<Victim> placeWith(uint32_t index_to_use, uint32_t fingerprint);
+
+    /**
+     * Keep a fingerprint no path found room for in the stash, between beginWrite and endWrite
+     * @param victim The full fingerprint and one of its buckets, unreduced or reduced
+     * @return True if it was stashed, false if the stash is full
+     */
+    bool stashVictim(const Victim &victim);
+
+    /**
+     * Check the stash for a full fingerprint in either of two buckets
+     * @return Position of the entry, STASH_SIZE if there is none
+     */
+    [[nodiscard]] std::size_t findStashed(std::size_t index1, std::size_t index2, uint32_t fingerprint) const;
+
+    /**
+     * Count the stashed copies of a full fingerprint in either of two buckets
+     * @return Number of matching entries
+     */
+    [[nodiscard]] std::size_t countStashed(std::size_t index1, std::size_t index2, uint32_t fingerprint) const;
+
+    /**
+     * Move stashed fingerprints into the buckets where paths have opened up, between beginWrite and endWrite
+     */
+    void drainStash();
+
+    /**
+     * Probe both candidate buckets
+     * @param index1 First bucket
+     * @param index2 Second bucket
+     * @param fingerprint Fingerprint shifted to the node's level
+     * @return Match mask, see ProbeFunction
+     */
+    [[nodiscard]] uint32_t probeBuckets(std::size_t index1, std::size_t index2, uint32_t fingerprint) const {
+        return (this->*kernels.probe)(index1, index2, fingerprint);
+    }
+
+    /**
+     * probeBuckets for a width fixed at compile time, or the node's runtime width when Bits is 0
+     */
+    template <unsigned Bits>
+    [[nodiscard]] uint32_t probeWith(std::size_t index1, std::size_t index2, uint32_t fingerprint) const;
+
+    /**
+     * Get the kernels for a stored fingerprint width
+     * @param width Bits stored per slot
+     * @param specialized False to always get the runtime width kernels
+     * @return The kernels
+     */
+    static Kernels kernelsFor(std::size_t width, bool specialized);
+
+    /**
+     * Decide if the compiled kernels beat the runtime width ones at a width, the default of a new node
+     * @param width Bits stored per slot
+     * @param probe Runtime width probe picked for the running CPU
+     * @return True if the node should use the compiled kernels
+     */
+    static bool prefersCompiledKernels(std::size_t width, ProbeFunction probe);
+
+    /**
+     * Look up the compiled kernels of a width between MIN_SPECIALIZED_WIDTH and MAX_SPECIALIZED_WIDTH
+     */
+    template <std::size_t... Offsets>
+    static Kernels specializedKernels(std::size_t width, std::index_sequence<Offsets...>);
+
+    /**
+     * Start changing the buckets, concurrent probes will retry
+     */
+    void beginWrite() {
+        version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
 
-    std::vector<Bucket> buckets;
+    /**
+     * Publish the changes made since beginWrite
+     */
+    void endWrite() {
+        version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
 
-    std::vector<bool> full_slots; 
+    /**
+     * View a byte range as a key without copying it
+     */
+    static std::string_view toView(const void *data, std::size_t length) {
+        return {static_cast<const char*>(data), length};
+    }
+
+    /**
+     * Get the bucket at the given index
+     * @param index Index of the bucket
+     * @return Bucket view into the slab
+     */
+    [[nodiscard]] Bucket bucket(std::size_t index) const { return Bucket{storage + index * bytes_per_bucket}; }
 
     /**
      * Get next power of two
@@ -201,4 +658,6 @@ private:
     static std::size_t nextPowerOfTwo(std::size_t n) ;
 };
 
+using CuckooFilter = BasicCuckooFilter<DefaultHashPolicy>;
+
 #endif // CUCKOO_FILTER_HPP
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "Epoch.hpp"
+
+namespace {
+
+// Slot indices of exited threads, handed out again before new ones, so the indices stay dense
+std::mutex free_slots_lock;
+std::vector<std::size_t> free_slots;
+std::size_t next_slot = 0;
+
+// Owns the calling thread's slot index for the lifetime of the thread
+struct ThreadSlot {
+    std::size_t index;
+
+    ThreadSlot() {
+        std::lock_guard<std::mutex> lock(free_slots_lock);
+        if (!free_slots.empty()) {
+            index = free_slots.back();
+            free_slots.pop_back();
+        } else {
+            index = next_slot++;
+        }
+    }
+
+    ~ThreadSlot() {
+        std::lock_guard<std::mutex> lock(free_slots_lock);
+        free_slots.push_back(index);
+    }
+};
+
+} // namespace
+
+// Constructor
+EpochManager::EpochManager(): global_epoch(1) {}
+
+// Destructor
+EpochManager::~EpochManager() {
+    for (auto &item : retired) {
+        item.deleter();
+    }
+    auto *chunk = first_chunk.next.load(std::memory_order_relaxed);
+    while (chunk != nullptr) {
+        auto *next = chunk->next.load(std::memory_order_relaxed);
+        delete chunk;
+        chunk = next;
+    }
+}
+
+// Pin the calling thread to the current epoch, unless an outer guard already did
+EpochManager::Guard::Guard(EpochManager *manager): manager(manager), slot(nullptr) {
+    auto &own = manager->slotAt(threadSlot()).epoch;
+    if (own.load(std::memory_order_relaxed) != 0) {
+        return;
+    }
+    // the store must be visible before any pointer of the structure is read, the fence keeps the loads
+    // that follow from moving ahead of it and pairs with the fence in collect
+    own.store(manager->global_epoch.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    slot = &own;
+}
+
+// Unpin
+EpochManager::Guard::~Guard() {
+    if (slot != nullptr) {
+        slot->store(0, std::memory_order_release);
+    }
+}
+
+// Retire an unlinked object, readers pinned before the next epoch may still hold it
+void EpochManager::retire(std::function<void()> deleter) {
+    std::lock_guard<std::mutex> lock(retired_lock);
+    auto epoch = global_epoch.fetch_add(1, std::memory_order_seq_cst);
+    retired.push_back(Retired{epoch, std::move(deleter)});
+}
+
+// Delete whatever was retired before the oldest pinned reader started
+std::size_t EpochManager::collect() {
+    // pairs with the fence after the pin: a reader either shows up in its slot here, or pinned late enough
+    // to read only pointers stored before the unlink
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto oldest = UINT64_MAX;
+    for (const auto *chunk = &first_chunk; chunk != nullptr; chunk = chunk->next.load(std::memory_order_acquire)) {
+        for (const auto &slot : chunk->slots) {
+            auto epoch = slot.epoch.load(std::memory_order_seq_cst);
+            if (epoch != 0) {
+                oldest = std::min(oldest, epoch);
+            }
+        }
+    }
+
+    std::vector<Retired> ready;
+    {
+        std::lock_guard<std::mutex> lock(retired_lock);
+        auto split = std::stable_partition(retired.begin(), retired.end(),
+                                           [oldest](const Retired &item) { return item.epoch >= oldest; });
+        ready.assign(std::make_move_iterator(split), std::make_move_iterator(retired.end()));
+        retired.erase(split, retired.end());
+    }
+    for (auto &item : ready) {
+        item.deleter();
+    }
+    return ready.size();
+}
+
+// Number of retired objects not deleted yet
+std::size_t EpochManager::pending() const {
+    std::lock_guard<std::mutex> lock(retired_lock);
+    return retired.size();
+}
+
+// Slot of the calling thread
+std::size_t EpochManager::threadSlot() {
+    thread_local ThreadSlot slot;
+    return slot.index;
+}
+
+// Walk to the slot's chunk, a thread that finds the list too short appends a chunk; losing the race frees it
+EpochManager::Slot &EpochManager::slotAt(std::size_t index) {
+    auto *chunk = &first_chunk;
+    for (std::size_t i = 0; i < index / EPOCH_CHUNK_SLOTS; i++) {
+        auto *next = chunk->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            auto *added = new SlotChunk();
+            if (chunk->next.compare_exchange_strong(next, added, std::memory_order_acq_rel)) {
+                next = added;
+            } else {
+                delete added;
+            }
+        }
+        chunk = next;
+    }
+    return chunk->slots[index % EPOCH_CHUNK_SLOTS];
+}
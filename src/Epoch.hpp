@@ -0,0 +1,118 @@
+#ifndef EPOCH_HPP
+#define EPOCH_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Reader slots per chunk, a manager adds chunks as more threads pin it
+const std::size_t EPOCH_CHUNK_SLOTS = 256;
+
+/**
+ * Epoch based reclamation
+ * Readers pin the current epoch for as long as they hold pointers into a structure. The writer unlinks
+ * an object first and retires it after, it is deleted once every reader pinned at the time has left.
+ * Pinning is one store and never waits for the writer.
+ */
+class EpochManager {
+public:
+    /**
+     * Pins the calling thread while alive, nested guards on the same thread are free
+     */
+    class Guard {
+    public:
+        explicit Guard(EpochManager *manager);
+        ~Guard();
+
+        Guard(const Guard &other) = delete;
+        Guard &operator=(const Guard &other) = delete;
+
+    private:
+        EpochManager *manager;
+        std::atomic<uint64_t> *slot;
+    };
+
+    EpochManager();
+
+    /**
+     * Destructor, deletes everything still retired, no reader may be pinned
+     */
+    ~EpochManager();
+
+    EpochManager(const EpochManager &other) = delete;
+    EpochManager &operator=(const EpochManager &other) = delete;
+
+    /**
+     * Pin the calling thread
+     * @return Guard that unpins it when it goes out of scope
+     */
+    [[nodiscard]] Guard pin() { return Guard(this); }
+
+    /**
+     * Delete an object once no reader can still see it
+     * @param object Object that was already unlinked from the structure
+     */
+    template <typename T>
+    void retire(T *object) {
+        retire([object]() { delete object; });
+    }
+
+    /**
+     * Run a deleter once no reader can still see what it deletes
+     * @param deleter Frees an object that was already unlinked from the structure
+     */
+    void retire(std::function<void()> deleter);
+
+    /**
+     * Run the deleters of everything no pinned reader can see any more
+     * @return Number of deleters run
+     */
+    std::size_t collect();
+
+    /**
+     * Get the number of retired objects that were not deleted yet
+     * @return The number of pending deleters
+     */
+    [[nodiscard]] std::size_t pending() const;
+
+private:
+    struct Retired {
+        uint64_t epoch;
+        std::function<void()> deleter;
+    };
+
+    // one cache line per thread, 0 while the thread is not pinned
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{0};
+    };
+
+    // a linked list of chunks that only grows, slot i of the process is in chunk i / EPOCH_CHUNK_SLOTS
+    struct SlotChunk {
+        Slot slots[EPOCH_CHUNK_SLOTS];
+        std::atomic<SlotChunk*> next{nullptr};
+    };
+
+    std::atomic<uint64_t> global_epoch;
+    SlotChunk first_chunk;
+
+    mutable std::mutex retired_lock;
+    std::vector<Retired> retired;
+
+    /**
+     * Get the index of the calling thread's slot, it is given back when the thread exits
+     * @return Slot index, below the number of live threads that ever pinned an epoch
+     */
+    static std::size_t threadSlot();
+
+    /**
+     * Get a slot, appending chunks until it exists
+     * @param index Slot index from threadSlot
+     * @return The slot
+     */
+    Slot &slotAt(std::size_t index);
+};
+
+#endif // EPOCH_HPP
@@ -0,0 +1,41 @@
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+#include "FilterStats.hpp"
+
+// Write the stats as one JSON object
+std::string FilterStats::toJson() const {
+    std::ostringstream out;
+    out.precision(10);
+
+    out << "{\"items\":" << items
+        << ",\"capacity\":" << capacity
+        << ",\"nodes\":" << nodes
+        << ",\"nodes_per_level\":[";
+    for (std::size_t level = 0; level < nodes_per_level.size(); level++) {
+        out << (level == 0 ? "" : ",") << nodes_per_level[level];
+    }
+    out << "],\"bytes\":{\"total\":" << total_bytes
+        << ",\"fingerprints\":" << fingerprint_bytes
+        << ",\"occupancy\":" << occupancy_bytes
+        << ",\"padding\":" << padding_bytes
+        << ",\"node_overhead\":" << node_overhead_bytes
+        << ",\"filter_overhead\":" << filter_overhead_bytes
+        << ",\"reserved\":" << reserved_bytes
+        << "},\"bits_per_item\":" << bits_per_item
+        << ",\"path_length\":{\"max\":" << max_path_length << ",\"mean\":" << mean_path_length << "}"
+        << ",\"false_positive_rate\":" << false_positive_rate
+        << ",\"node_list\":[";
+    for (std::size_t i = 0; i < node_list.size(); i++) {
+        const auto &node = node_list[i];
+        out << (i == 0 ? "" : ",")
+            << "{\"level\":" << node.level
+            << ",\"items\":" << node.items
+            << ",\"capacity\":" << node.capacity
+            << ",\"load_factor\":" << node.load_factor
+            << ",\"fingerprint_bits\":" << node.fingerprint_bits << "}";
+    }
+    out << "]}";
+    return out.str();
+}
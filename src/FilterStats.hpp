@@ -0,0 +1,60 @@
+#ifndef FILTER_STATS_HPP
+#define FILTER_STATS_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * State of one node of the tree
+ */
+struct NodeStats {
+    int level;
+    std::size_t items;
+    std::size_t capacity;
+    double load_factor;
+    // bits stored per slot, the fingerprint size minus the level
+    std::size_t fingerprint_bits;
+};
+
+/**
+ * Snapshot of a filter's shape, memory and accuracy, see BasicLogarithmicDynamicCuckooFilter::stats
+ */
+struct FilterStats {
+    std::size_t items = 0;
+    // items the allocated nodes hold before another node is needed
+    std::size_t capacity = 0;
+    std::size_t nodes = 0;
+    // nodes_per_level[l] is the number of nodes at level l
+    std::vector<std::size_t> nodes_per_level;
+    // every node in pre-order
+    std::vector<NodeStats> node_list;
+
+    // the bytes add up to total_bytes, which is memoryUsage()
+    std::size_t fingerprint_bytes = 0;
+    std::size_t occupancy_bytes = 0;
+    // bucket rounding and slab alignment
+    std::size_t padding_bytes = 0;
+    std::size_t node_overhead_bytes = 0;
+    // the filter object and its routing table
+    std::size_t filter_overhead_bytes = 0;
+    std::size_t total_bytes = 0;
+    // mapped by the node arenas, used or not, pages only count towards the resident set once touched
+    std::size_t reserved_bytes = 0;
+    double bits_per_item = 0;
+
+    // nodes probed by a lookup of a key that is not in the filter, the mean is over uniform keys
+    std::size_t max_path_length = 0;
+    double mean_path_length = 0;
+
+    // chance that a key that was never inserted is found, from the load and width of every node
+    double false_positive_rate = 0;
+
+    /**
+     * Write the stats as one JSON object
+     * @return The JSON text, without a trailing newline
+     */
+    [[nodiscard]] std::string toJson() const;
+};
+
+#endif // FILTER_STATS_HPP
@@ -0,0 +1,126 @@
+#ifndef FIXED_BUCKET_HPP
+#define FIXED_BUCKET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Bucket access for a fingerprint width known at compile time
+ * Same layout as Bucket: Slots fingerprints of Bits bits followed by Slots occupancy bits. Every offset,
+ * shift and mask is a constant, 8, 16 and 32 bit slots are read and written as whole bytes and
+ * 8 and 16 bit buckets are compared with one SWAR word compare.
+ * @tparam Bits Fingerprint width stored in the node, 1 to 32
+ * @tparam Slots Slots per bucket
+ */
+template <unsigned Bits, unsigned Slots>
+struct FixedBucket {
+    static_assert(Bits >= 1 && Bits <= 32, "fingerprints are 1 to 32 bits");
+    static_assert(Slots >= 1 && Slots <= 16, "the match mask holds two buckets in 32 bits");
+
+    static constexpr unsigned OCCUPANCY_BIT = Bits * Slots;
+    static constexpr uint64_t MASK = (1ULL << Bits) - 1;
+    static constexpr uint32_t SLOT_MASK = (1U << Slots) - 1;
+    static constexpr bool BYTE_ALIGNED = Bits == 8 || Bits == 16 || Bits == 32;
+
+    // Read fingerprint from the bucket
+    static uint32_t read(const char *bucket, std::size_t position) {
+        if constexpr (Bits == 8) {
+            return static_cast<uint8_t>(bucket[position]);
+        } else if constexpr (Bits == 16) {
+            uint16_t value;
+            memcpy(&value, bucket + position * 2, sizeof(value));
+            return value;
+        } else if constexpr (Bits == 32) {
+            uint32_t value;
+            memcpy(&value, bucket + position * 4, sizeof(value));
+            return value;
+        } else {
+            auto bit = position * Bits;
+            return static_cast<uint32_t>((load(bucket + bit / 8) >> (bit % 8)) & MASK);
+        }
+    }
+
+    // Write fingerprint to the bucket
+    static void write(char *bucket, std::size_t position, uint32_t fingerprint) {
+        if constexpr (Bits == 8) {
+            bucket[position] = static_cast<char>(fingerprint);
+        } else if constexpr (Bits == 16) {
+            auto value = static_cast<uint16_t>(fingerprint);
+            memcpy(bucket + position * 2, &value, sizeof(value));
+        } else if constexpr (Bits == 32) {
+            memcpy(bucket + position * 4, &fingerprint, sizeof(fingerprint));
+        } else {
+            auto bit = position * Bits;
+            auto word = load(bucket + bit / 8);
+            word &= ~(MASK << (bit % 8));
+            word |= (fingerprint & MASK) << (bit % 8);
+            store(bucket + bit / 8, word);
+        }
+    }
+
+    // Read the occupancy bits, bit i is set if slot i holds a fingerprint
+    static uint32_t occupancy(const char *bucket) {
+        return static_cast<uint32_t>(load(bucket + OCCUPANCY_BIT / 8) >> (OCCUPANCY_BIT % 8)) & SLOT_MASK;
+    }
+
+    // Mark the slot as full or empty
+    static void setOccupied(char *bucket, std::size_t position, bool occupied) {
+        auto word = load(bucket + OCCUPANCY_BIT / 8);
+        auto bit = 1ULL << (OCCUPANCY_BIT % 8 + position);
+        word = occupied ? (word | bit) : (word & ~bit);
+        store(bucket + OCCUPANCY_BIT / 8, word);
+    }
+
+    // Slots holding the fingerprint, occupied or not
+    static uint32_t matches(const char *bucket, uint32_t fingerprint) {
+        if constexpr (Bits == 8 && Slots == 4) {
+            uint32_t word;
+            memcpy(&word, bucket, sizeof(word));
+            return lanes8(word ^ (fingerprint * 0x01010101U));
+        } else if constexpr (Bits == 16 && Slots == 4) {
+            return lanes16(load(bucket) ^ (fingerprint * 0x0001000100010001ULL));
+        } else {
+            uint32_t found = 0;
+            for (unsigned i = 0; i < Slots; i++) {
+                found |= static_cast<uint32_t>(read(bucket, i) == fingerprint) << i;
+            }
+            return found;
+        }
+    }
+
+    /**
+     * Probe both candidate buckets, like ProbeFunction
+     * @return Match mask, bit i is slot i of bucket1 and bit Slots + i is slot i of bucket2
+     */
+    static uint32_t probe(const char *bucket1, const char *bucket2, uint32_t fingerprint) {
+        return (matches(bucket1, fingerprint) & occupancy(bucket1)) |
+               ((matches(bucket2, fingerprint) & occupancy(bucket2)) << Slots);
+    }
+
+private:
+    static uint64_t load(const char *p) {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static void store(char *p, uint64_t value) {
+        memcpy(p, &value, sizeof(value));
+    }
+
+    // One bit per zero byte of x, exact, no carries between lanes
+    static uint32_t lanes8(uint32_t x) {
+        uint32_t y = ~(((x & 0x7F7F7F7FU) + 0x7F7F7F7FU) | x | 0x7F7F7F7FU);
+        return ((y >> 7) & 1U) | ((y >> 14) & 2U) | ((y >> 21) & 4U) | ((y >> 28) & 8U);
+    }
+
+    // One bit per zero 16 bit lane of x
+    static uint32_t lanes16(uint64_t x) {
+        const uint64_t low = 0x7FFF7FFF7FFF7FFFULL;
+        uint64_t y = ~(((x & low) + low) | x | low);
+        return static_cast<uint32_t>(((y >> 15) & 1U) | ((y >> 30) & 2U) | ((y >> 45) & 4U) | ((y >> 60) & 8U));
+    }
+};
+
+#endif // FIXED_BUCKET_HPP
@@ -0,0 +1,125 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string_view>
+
+/**
+ * Hash policies
+ * A policy hashes keys for the bucket index and fingerprint, and mixes fingerprints for the alternate
+ * bucket (index ^ hash(fingerprint)). It is a template parameter of the filters:
+ *   static uint64_t hash(std::string_view item);
+ *   static uint64_t hash(uint64_t item);
+ *   static constexpr const char *name;
+ */
+
+/**
+ * Standard library hashing
+ * std::hash<std::size_t> is the identity on libstdc++, so alternate buckets are poorly mixed
+ */
+struct StdHashPolicy {
+    static constexpr const char *name = "std::hash";
+
+    static uint64_t hash(std::string_view item) {
+        return std::hash<std::string_view>{}(item);
+    }
+
+    static uint64_t hash(uint64_t item) {
+        return std::hash<uint64_t>{}(item);
+    }
+};
+
+/**
+ * wyhash (final version) for keys, the wyhash multiply-xor mix for integers
+ */
+struct WyHashPolicy {
+    static constexpr const char *name = "wyhash";
+
+    static constexpr uint64_t SECRET[4] = {0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+                                           0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
+
+    static uint64_t hash(std::string_view item) {
+        return hashBytes(item.data(), item.size(), 0);
+    }
+
+    static uint64_t hash(uint64_t item) {
+        return mix(item ^ SECRET[0], SECRET[1]);
+    }
+
+    // Hash a byte range
+    static uint64_t hashBytes(const void *key, std::size_t length, uint64_t seed) {
+        const auto *p = static_cast<const uint8_t*>(key);
+        seed ^= mix(seed ^ SECRET[0], SECRET[1]);
+        uint64_t a = 0;
+        uint64_t b = 0;
+        if (length <= 16) {
+            if (length >= 4) {
+                a = (read4(p) << 32) | read4(p + ((length >> 3) << 2));
+                b = (read4(p + length - 4) << 32) | read4(p + length - 4 - ((length >> 3) << 2));
+            } else if (length > 0) {
+                a = read3(p, length);
+            }
+        } else {
+            std::size_t i = length;
+            if (i > 48) {
+                uint64_t see1 = seed;
+                uint64_t see2 = seed;
+                do {
+                    seed = mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+                    see1 = mix(read8(p + 16) ^ SECRET[2], read8(p + 24) ^ see1);
+                    see2 = mix(read8(p + 32) ^ SECRET[3], read8(p + 40) ^ see2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= see1 ^ see2;
+            }
+            while (i > 16) {
+                seed = mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+            a = read8(p + i - 16);
+            b = read8(p + i - 8);
+        }
+        a ^= SECRET[1];
+        b ^= seed;
+        multiply(a, b);
+        return mix(a ^ SECRET[0] ^ length, b ^ SECRET[1]);
+    }
+
+private:
+    // 64x64 -> 128 bit multiply, low half in a, high half in b
+    static void multiply(uint64_t &a, uint64_t &b) {
+        __uint128_t product = static_cast<__uint128_t>(a) * b;
+        a = static_cast<uint64_t>(product);
+        b = static_cast<uint64_t>(product >> 64);
+    }
+
+    static uint64_t mix(uint64_t a, uint64_t b) {
+        multiply(a, b);
+        return a ^ b;
+    }
+
+    static uint64_t read8(const uint8_t *p) {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static uint64_t read4(const uint8_t *p) {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static uint64_t read3(const uint8_t *p, std::size_t k) {
+        return (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[k >> 1]) << 8) | p[k - 1];
+    }
+};
+
+using DefaultHashPolicy = WyHashPolicy;
+
+#endif // HASH_HPP
@@ -0,0 +1,113 @@
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Instrumentation.hpp"
+
+namespace {
+
+const char *const COUNTER_NAMES[COUNTER_COUNT] = {
+    "inserts", "victim_inserts", "insert_victims", "stashed", "stash_drains", "relocations", "duplicate_rejects",
+    "node_probes", "probe_retries", "removes", "remove_misses", "lookups", "nodes_created", "nodes_merged"
+};
+
+const char *const HISTOGRAM_NAMES[HISTOGRAM_COUNT] = {
+    "duplicate_matches", "path_length", "lookup_path", "insert_depth", "insert_latency_log2_ns", "lookup_latency_log2_ns"
+};
+
+// Counters of every live thread, and the sums of the threads that exited
+std::mutex registry_lock;
+std::vector<Instrumentation::ThreadCounters*> registry;
+InstrumentationSnapshot exited;
+
+void addTo(InstrumentationSnapshot &sum, const Instrumentation::ThreadCounters &counters) {
+    for (std::size_t i = 0; i < COUNTER_COUNT; i++) {
+        sum.counters[i] += counters.counters[i].load(std::memory_order_relaxed);
+    }
+    for (std::size_t h = 0; h < HISTOGRAM_COUNT; h++) {
+        for (std::size_t bin = 0; bin < HISTOGRAM_BINS; bin++) {
+            sum.histograms[h][bin] += counters.histograms[h][bin].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void clear(Instrumentation::ThreadCounters &counters) {
+    for (auto &counter : counters.counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    for (auto &histogram : counters.histograms) {
+        for (auto &bin : histogram) {
+            bin.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+// Registers the calling thread's counters for its lifetime, they are kept in the sums after it exits
+struct Registration {
+    Instrumentation::ThreadCounters counters;
+
+    Registration() {
+        clear(counters);
+        std::lock_guard<std::mutex> lock(registry_lock);
+        registry.push_back(&counters);
+    }
+
+    ~Registration() {
+        std::lock_guard<std::mutex> lock(registry_lock);
+        addTo(exited, counters);
+        for (auto it = registry.begin(); it != registry.end(); ++it) {
+            if (*it == &counters) {
+                registry.erase(it);
+                break;
+            }
+        }
+    }
+};
+
+} // namespace
+
+// Counters of the calling thread
+Instrumentation::ThreadCounters &Instrumentation::local() {
+    thread_local Registration registration;
+    return registration.counters;
+}
+
+// Sum every thread
+InstrumentationSnapshot Instrumentation::snapshot() {
+    std::lock_guard<std::mutex> lock(registry_lock);
+    auto sum = exited;
+    for (const auto *counters : registry) {
+        addTo(sum, *counters);
+    }
+    return sum;
+}
+
+// Zero every thread
+void Instrumentation::reset() {
+    std::lock_guard<std::mutex> lock(registry_lock);
+    exited = InstrumentationSnapshot{};
+    for (auto *counters : registry) {
+        clear(*counters);
+    }
+}
+
+// Write the snapshot as one JSON object
+std::string InstrumentationSnapshot::toJson() const {
+    std::ostringstream out;
+    out << "{";
+    for (std::size_t i = 0; i < COUNTER_COUNT; i++) {
+        out << (i == 0 ? "" : ",") << "\"" << COUNTER_NAMES[i] << "\":" << counters[i];
+    }
+    for (std::size_t h = 0; h < HISTOGRAM_COUNT; h++) {
+        out << ",\"" << HISTOGRAM_NAMES[h] << "\":[";
+        for (std::size_t bin = 0; bin < HISTOGRAM_BINS; bin++) {
+            out << (bin == 0 ? "" : ",") << histograms[h][bin];
+        }
+        out << "]";
+    }
+    out << "}";
+    return out.str();
+}
@@ -0,0 +1,175 @@
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Events counted on the hot paths
+ */
+enum class Counter : std::size_t {
+    INSERTS,                // CuckooFilter::insert of a new key
+    VICTIM_INSERTS,         // CuckooFilter::insert of a fingerprint pushed down from a parent
+    INSERT_VICTIMS,         // inserts that found no room and handed the fingerprint to a child
+    STASHED,                // fingerprints kept in a node's stash instead of going to a child
+    STASH_DRAINS,           // stashed fingerprints moved into a bucket after a remove
+    RELOCATIONS,            // fingerprints moved along cuckoo paths
+    DUPLICATE_REJECTS,      // keys dropped because their buckets already hold BUCKET_SIZE copies
+    NODE_PROBES,            // CuckooFilter::contains calls
+    PROBE_RETRIES,          // probes repeated because a write overlapped them
+    REMOVES,                // CuckooFilter::remove calls
+    REMOVE_MISSES,          // removes that found nothing
+    LOOKUPS,                // keys looked up in the tree
+    NODES_CREATED,
+    NODES_MERGED,
+    COUNT
+};
+
+/**
+ * Distributions recorded on the hot paths
+ */
+enum class Histogram : std::size_t {
+    DUPLICATE_MATCHES,      // copies of the fingerprint already in the key's buckets, per insert
+    PATH_LENGTH,            // moves needed to store a fingerprint
+    LOOKUP_PATH,            // nodes probed per lookup in the tree
+    INSERT_DEPTH,           // level of the node an insert into the tree lands in
+    INSERT_LATENCY,         // nanoseconds per insert call of the tree, batches are not timed
+    LOOKUP_LATENCY,         // nanoseconds per contains call of the tree, batches are not timed
+    COUNT
+};
+
+const std::size_t COUNTER_COUNT = static_cast<std::size_t>(Counter::COUNT);
+const std::size_t HISTOGRAM_COUNT = static_cast<std::size_t>(Histogram::COUNT);
+
+// Bin i counts the value i, the last bin every larger one too; latencies are binned by powers of two
+const std::size_t HISTOGRAM_BINS = 32;
+
+/**
+ * Counters summed over every thread
+ */
+struct InstrumentationSnapshot {
+    std::array<uint64_t, COUNTER_COUNT> counters{};
+    std::array<std::array<uint64_t, HISTOGRAM_BINS>, HISTOGRAM_COUNT> histograms{};
+
+    [[nodiscard]] uint64_t operator[](Counter counter) const { return counters[static_cast<std::size_t>(counter)]; }
+
+    [[nodiscard]] const std::array<uint64_t, HISTOGRAM_BINS> &operator[](Histogram histogram) const {
+        return histograms[static_cast<std::size_t>(histogram)];
+    }
+
+    /**
+     * Write the snapshot as one JSON object, histograms as arrays of bins
+     * @return The JSON text, without a trailing newline
+     */
+    [[nodiscard]] std::string toJson() const;
+};
+
+/**
+ * Per-thread counters and histograms of the filter's hot paths
+ * Only compiled into the filter with -DLDCF_INSTRUMENTATION (CMake option LDCF_INSTRUMENTATION), otherwise the
+ * LDCF_COUNT, LDCF_RECORD and LDCF_TIME macros expand to nothing and snapshot() stays zero. Every thread
+ * writes its own cache lines without atomic read-modify-writes, snapshot and reset visit all of them.
+ */
+class Instrumentation {
+public:
+#ifdef LDCF_INSTRUMENTATION
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    /**
+     * Counters and histograms of one thread, written only by that thread
+     */
+    struct alignas(64) ThreadCounters {
+        std::atomic<uint64_t> counters[COUNTER_COUNT];
+        std::atomic<uint64_t> histograms[HISTOGRAM_COUNT][HISTOGRAM_BINS];
+    };
+
+    /**
+     * Times a scope into a latency histogram
+     */
+    class Timer {
+    public:
+        explicit Timer(Histogram histogram): histogram(histogram), start(std::chrono::steady_clock::now()) {}
+        ~Timer() {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            recordLatency(histogram, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+
+        Timer(const Timer &other) = delete;
+        Timer &operator=(const Timer &other) = delete;
+
+    private:
+        Histogram histogram;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    /**
+     * Add to a counter of the calling thread
+     * @param counter The counter
+     * @param amount The amount to add
+     */
+    static void add(Counter counter, uint64_t amount) {
+        bump(local().counters[static_cast<std::size_t>(counter)], amount);
+    }
+
+    /**
+     * Count a value in a histogram of the calling thread
+     * @param histogram The histogram
+     * @param value The value, values past the last bin go into it
+     */
+    static void record(Histogram histogram, uint64_t value) {
+        auto bin = value < HISTOGRAM_BINS ? value : HISTOGRAM_BINS - 1;
+        bump(local().histograms[static_cast<std::size_t>(histogram)][bin], 1);
+    }
+
+    /**
+     * Count a duration in a histogram of the calling thread, bin i holds [2^(i-1), 2^i) nanoseconds
+     * @param histogram The histogram
+     * @param nanoseconds The duration
+     */
+    static void recordLatency(Histogram histogram, uint64_t nanoseconds) {
+        auto bin = nanoseconds == 0 ? 0 : 64 - static_cast<uint64_t>(__builtin_clzll(nanoseconds));
+        record(histogram, bin);
+    }
+
+    /**
+     * Sum the counters of every thread, including threads that exited
+     * @return The sums, all zero if instrumentation is compiled out
+     */
+    static InstrumentationSnapshot snapshot();
+
+    /**
+     * Zero the counters of every thread, counts of threads running meanwhile may be lost
+     */
+    static void reset();
+
+private:
+    /**
+     * Get the calling thread's counters, registered on first use
+     * @return The counters
+     */
+    static ThreadCounters &local();
+
+    // only the owning thread writes, so a load and a store are enough
+    static void bump(std::atomic<uint64_t> &value, uint64_t amount) {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+};
+
+#ifdef LDCF_INSTRUMENTATION
+#define LDCF_COUNT(counter, amount) Instrumentation::add(Counter::counter, (amount))
+#define LDCF_RECORD(histogram, value) Instrumentation::record(Histogram::histogram, (value))
+#define LDCF_TIME(histogram) Instrumentation::Timer ldcf_timer_##histogram(Histogram::histogram)
+#else
+#define LDCF_COUNT(counter, amount) ((void)0)
+#define LDCF_RECORD(histogram, value) ((void)0)
+#define LDCF_TIME(histogram) ((void)0)
+#endif
+
+#endif // INSTRUMENTATION_HPP
@@ -0,0 +1,35 @@
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "Kmer.hpp"
+
+// Constructor
+KmerEncoder::KmerEncoder(std::size_t k, bool canonical):
+    k(k), canonical(canonical), mask(0), reverse_shift(0) {
+    if (k == 0 || k > MAX_KMER_SIZE) {
+        throw std::invalid_argument("k must be between 1 and 32");
+    }
+    mask = k == MAX_KMER_SIZE ? ~0ULL : (1ULL << (2 * k)) - 1;
+    reverse_shift = 2 * (k - 1);
+}
+
+// Count the k-mers of a sequence
+std::size_t KmerEncoder::count(std::string_view sequence) const {
+    std::size_t kmers = 0;
+    forEach(sequence, [&](uint64_t) { kmers++; });
+    return kmers;
+}
+
+// Decode a packed k-mer
+std::string KmerEncoder::decode(uint64_t kmer) const {
+    static const char bases[] = "ACGT";
+    std::string decoded(k, 'A');
+    for (std::size_t i = 0; i < k; i++) {
+        decoded[k - 1 - i] = bases[kmer & 3];
+        kmer >>= 2;
+    }
+    return decoded;
+}
@@ -0,0 +1,140 @@
+#ifndef KMER_HPP
+#define KMER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Largest k that fits a 2-bit packed k-mer into 64 bits
+const std::size_t MAX_KMER_SIZE = 32;
+
+// Codes of the bytes that are not bases
+const uint8_t RESET_CODE = 4;
+const uint8_t SKIP_CODE = 5;
+
+// 2-bit code of every byte, A/C/G/T in either case map to 0..3, line breaks of multi-line records are
+// skipped and anything else (N, IUPAC codes) resets the window
+struct BaseCodes {
+    uint8_t codes[256];
+
+    constexpr BaseCodes() : codes() {
+        for (auto &code : codes) {
+            code = RESET_CODE;
+        }
+        codes['\n'] = codes['\r'] = SKIP_CODE;
+        codes['A'] = codes['a'] = 0;
+        codes['C'] = codes['c'] = 1;
+        codes['G'] = codes['g'] = 2;
+        codes['T'] = codes['t'] = 3;
+    }
+};
+
+inline constexpr BaseCodes BASE_CODES{};
+
+/**
+ * Rolling 2-bit k-mer encoder
+ * Slides a window of k bases over a DNA sequence and keeps the packed forward k-mer and its reverse
+ * complement up to date with a shift per base, so no k-mer is ever materialized as a string.
+ * A base other than A/C/G/T resets the window, line breaks are ignored.
+ */
+class KmerEncoder {
+public:
+    /**
+     * Constructor
+     * @param k Length of the k-mers, 1 to MAX_KMER_SIZE
+     * @param canonical Yield the smaller of a k-mer and its reverse complement
+     */
+    KmerEncoder(std::size_t k, bool canonical);
+
+    /**
+     * Call the callback with every k-mer of the sequence, in order
+     * @param sequence The bases
+     * @param callback Called with the packed k-mer, the first base in the highest bits
+     */
+    template <typename Callback>
+    void forEach(std::string_view sequence, Callback &&callback) const {
+        uint64_t forward = 0;
+        uint64_t reverse = 0;
+        std::size_t length = 0;
+        for (char base : sequence) {
+            uint64_t code = BASE_CODES.codes[static_cast<uint8_t>(base)];
+            if (code > 3) {
+                if (code == SKIP_CODE) {
+                    continue;
+                }
+                length = 0;
+                forward = 0;
+                reverse = 0;
+                continue;
+            }
+
+            forward = ((forward << 2) | code) & mask;
+            reverse = (reverse >> 2) | ((3 - code) << reverse_shift);
+            if (++length >= k) {
+                callback((canonical && reverse < forward) ? reverse : forward);
+            }
+        }
+    }
+
+    /**
+     * Count the k-mers of a sequence
+     * @param sequence The bases
+     * @return The number of windows of k valid bases
+     */
+    [[nodiscard]] std::size_t count(std::string_view sequence) const;
+
+    /**
+     * Decode a packed k-mer back to bases
+     * @param kmer The packed k-mer
+     * @return The k bases
+     */
+    [[nodiscard]] std::string decode(uint64_t kmer) const;
+
+    /**
+     * Get the k-mer length
+     * @return k
+     */
+    [[nodiscard]] std::size_t getK() const { return k; }
+
+private:
+    std::size_t k;
+    bool canonical;
+    uint64_t mask;
+    std::size_t reverse_shift;
+};
+
+/**
+ * Insert every k-mer of a sequence into a filter, through its 64-bit hash path
+ * @param filter Filter with insert(uint64_t) and a static hash(uint64_t) mixer
+ * @param encoder The k-mer encoder
+ * @param sequence The bases
+ * @return The number of k-mers inserted
+ */
+template <typename Filter>
+std::size_t insertKmers(Filter &filter, const KmerEncoder &encoder, std::string_view sequence) {
+    std::size_t inserted = 0;
+    encoder.forEach(sequence, [&](uint64_t kmer) {
+        filter.insert(Filter::hash(kmer));
+        inserted++;
+    });
+    return inserted;
+}
+
+/**
+ * Count how many k-mers of a sequence the filter contains
+ * @param filter Filter with contains(uint64_t) and a static hash(uint64_t) mixer
+ * @param encoder The k-mer encoder
+ * @param sequence The bases
+ * @return The number of k-mers found
+ */
+template <typename Filter>
+std::size_t countKmers(const Filter &filter, const KmerEncoder &encoder, std::string_view sequence) {
+    std::size_t found = 0;
+    encoder.forEach(sequence, [&](uint64_t kmer) {
+        found += filter.contains(Filter::hash(kmer)) ? 1 : 0;
+    });
+    return found;
+}
+
+#endif // KMER_HPP
@@ -1,16 +1,146 @@
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <bitset>   
 #include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
 #include <sys/types.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "CF.hpp"
 #include "LDCF.hpp"
+#include "Instrumentation.hpp"
+#include "NodeArena.hpp"
+
+namespace {
+
+// On-disk layout, all integers little-endian:
+//   header, FILE_HEADER_SIZE bytes:
+//     0  magic "LDCFTREE"
+//     8  u32 format version
+//     12 u32 header size
+//     16 u64 hash policy tag, wyhash of the policy name
+//     24 u64 number of buckets of the root, as passed to it
+//     32 u64 fingerprint size in bits
+//     40 u64 number of items
+//     48 u64 number of nodes
+//     56 u64 checksum, wyhash chained over every node record and slab in file order
+//     64 u64 growth factor, a node at level l has the root's buckets times growth factor^l
+//     zero padding; version 1 files end the header at 64 and have a growth factor of 1
+//   nodes in pre-order (node, child0 subtree, child1 subtree), each one:
+//     NODE_HEADER_SIZE bytes: u32 level, u32 flags, u64 items in the buckets, u64 slab size, u32 stashed items,
+//     u32 padding, then STASH_SIZE pairs of u32 full fingerprint and u32 bucket; versions 1 and 2 have no stash
+//     and zeros there
+//     the bucket slab as kept in memory, a multiple of CACHE_LINE_SIZE
+// Every slab starts on a CACHE_LINE_SIZE boundary of the file, so a mapped file can be probed in place.
+const char FILE_MAGIC[8] = {'L', 'D', 'C', 'F', 'T', 'R', 'E', 'E'};
+const uint32_t FILE_FORMAT_VERSION = 3;
+const std::size_t FILE_HEADER_SIZE = 128;
+const std::size_t VERSION_1_HEADER_SIZE = 64;
+const std::size_t NODE_HEADER_SIZE = 64;
+
+const uint32_t NODE_HAS_CHILD0 = 1;
+const uint32_t NODE_HAS_CHILD1 = 2;
+const uint32_t NODE_ACCEPTS_VALUES = 4;
+
+static_assert(FILE_HEADER_SIZE % CACHE_LINE_SIZE == 0 && VERSION_1_HEADER_SIZE % CACHE_LINE_SIZE == 0 &&
+              NODE_HEADER_SIZE % CACHE_LINE_SIZE == 0,
+              "slabs must stay cache line aligned in the file");
+static_assert(32 + STASH_SIZE * 8 <= NODE_HEADER_SIZE, "the stash must fit the node record");
+static_assert(ARENA_ALIGNMENT % CACHE_LINE_SIZE == 0, "arena slabs must be cache line aligned");
+
+// The bucket slabs are stored as they are in memory, which is the little-endian bit layout
+bool hostIsLittleEndian() {
+    return __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+}
+
+void putLittleEndian(char *target, uint64_t value, std::size_t bytes) {
+    for (std::size_t i = 0; i < bytes; i++) {
+        target[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+uint64_t getLittleEndian(const char *source, std::size_t bytes) {
+    uint64_t value = 0;
+    for (std::size_t i = 0; i < bytes; i++) {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(source[i])) << (8 * i);
+    }
+    return value;
+}
+
+// Add a subtree to the stats in pre-order
+// returns the mean number of nodes a missing key routed into it probes, and the chance that it matches
+template <typename Node>
+std::pair<double, double> collectStats(const Node *node, std::size_t fingerprint_size, FilterStats &stats) {
+    auto level = static_cast<std::size_t>(node->current_level);
+    auto width = fingerprint_size - level;
+    auto slots = node->getNumberOfBuckets() * BUCKET_SIZE;
+    auto load = static_cast<double>(node->size()) / static_cast<double>(slots);
+    stats.node_list.push_back(NodeStats{node->current_level, node->size(), node->capacity(), load, width});
+
+    stats.nodes++;
+    if (stats.nodes_per_level.size() <= level) {
+        stats.nodes_per_level.resize(level + 1, 0);
+    }
+    stats.nodes_per_level[level]++;
+    stats.capacity += node->capacity();
+    stats.max_path_length = std::max(stats.max_path_length, level + 1);
+
+    auto fingerprint_bytes = slots * width / BYTE_SIZE;
+    auto occupancy_bytes = slots / BYTE_SIZE;
+    auto slab = Node::slabSize(node->getNumberOfBuckets(), fingerprint_size, node->current_level);
+    stats.fingerprint_bytes += fingerprint_bytes;
+    stats.occupancy_bytes += occupancy_bytes;
+    stats.padding_bytes += slab - fingerprint_bytes - occupancy_bytes;
+    stats.node_overhead_bytes += sizeof(Node);
+
+    // both buckets of a key hold 2 * BUCKET_SIZE * load fingerprints on average, each matches with 2^-width
+    auto node_rate = 1 - pow(1 - ldexp(1.0, -static_cast<int>(width)), 2 * BUCKET_SIZE * load);
+
+    // half of the keys go on to each child
+    double path = 1;
+    double miss = 0;
+    for (const Node *child : {node->child0.load(std::memory_order_acquire), node->child1.load(std::memory_order_acquire)}) {
+        if (child == nullptr) {
+            miss += 0.5;
+            continue;
+        }
+        auto below = collectStats(child, fingerprint_size, stats);
+        path += 0.5 * below.first;
+        miss += 0.5 * (1 - below.second);
+    }
+    return {path, 1 - (1 - node_rate) * miss};
+}
+
+template <typename HashPolicy>
+uint64_t policyTag() {
+    return WyHashPolicy::hashBytes(HashPolicy::name, strlen(HashPolicy::name), 0);
+}
+
+} // namespace
 
 // Constructor
-LogarithmicDynamicCuckooFilter::LogarithmicDynamicCuckooFilter(double false_positive_rate, std::size_t set_size, std::size_t expected_levels):
-    size_(0) {
+template <typename HashPolicy>
+BasicLogarithmicDynamicCuckooFilter<HashPolicy>::BasicLogarithmicDynamicCuckooFilter(double false_positive_rate, std::size_t set_size, std::size_t expected_levels,
+                                                                                      std::size_t growth_factor):
+    size_(0), growth_factor(growth_factor), mapped_data(nullptr), mapped_size(0), read_only(false) {
+    if (growth_factor == 0 || (growth_factor & (growth_factor - 1)) != 0) {
+        throw std::runtime_error("The growth factor must be a power of two");
+    }
     number_of_buckets = set_size / (BUCKET_SIZE * expected_levels);
     auto single_CF_capacity = LOAD_FACTOR * number_of_buckets * BUCKET_SIZE;
     double b_2 = 2 * 4;
@@ -22,103 +152,849 @@ LogarithmicDynamicCuckooFilter::LogarithmicDynamicCuckooFilter(double false_posi
         this->fingerprint_size = BYTE_SIZE * 4; // max fingerprint size
     }
 
-    root = new CuckooFilter(number_of_buckets, this->fingerprint_size, 0);
+    root = createNode(0);
+    initRouting();
 }
 
-// Destructor
-LogarithmicDynamicCuckooFilter::~LogarithmicDynamicCuckooFilter() {
-    delete root;
+// Constructor of an empty shell, load and open_mapped fill it in
+template <typename HashPolicy>
+BasicLogarithmicDynamicCuckooFilter<HashPolicy>::BasicLogarithmicDynamicCuckooFilter():
+    size_(0), number_of_buckets(0), growth_factor(1), fingerprint_size(0), root(nullptr), routing_levels(0), mapped_data(nullptr), mapped_size(0), read_only(false) {}
+
+// Destructor, the arenas free every node at once
+template <typename HashPolicy>
+BasicLogarithmicDynamicCuckooFilter<HashPolicy>::~BasicLogarithmicDynamicCuckooFilter() {
+    unmapFile();
 }
 
-// Insert an item into the filter
-void LogarithmicDynamicCuckooFilter::insert(const std::string &item) {
-    int current_level = 0;
+// Insert a hashed item into the filter
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::insert(uint64_t hash) {
+    LDCF_TIME(INSERT_LATENCY);
+    checkWritable();
+    // hashed once, every level reuses the same key
+    insertKey(HashedKey::fromHash(hash, fingerprint_size));
+    size_.store(size_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+// Insert a key into the first node on its path that accepts values
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::insertKey(const HashedKey &key) {
+    // single threaded, nothing to lock
+    insertKey(key, [](int, uint32_t) { return std::unique_lock<std::mutex>(); });
+}
+
+// Insert a key, holding the lock lockNode hands out for the node it goes into and any node that gets a child
+template <typename HashPolicy>
+template <typename LockFunction>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::insertKey(const HashedKey &key, LockFunction &&lockNode) {
+    std::unique_lock<std::mutex> held;
     auto *current_CF = root;
-    uint32_t fingerprint = CuckooFilter::hash(item);
-    fingerprint = fingerprint & ((1 << current_CF->getFingerprintSize()) - 1);
+    auto fingerprint = key.fingerprint;
 
-    while (current_CF->isFull()) {
-        if (getPrefix(fingerprint, current_level, current_CF->getFingerprintSize())) {
-            if (current_CF->child0 == nullptr) {
-                current_CF->child0 = new CuckooFilter(number_of_buckets, fingerprint_size, current_level + 1);
-            }
-            current_CF = current_CF->child0;
-        } else {
-            if (current_CF->child1 == nullptr) {
-                current_CF->child1 = new CuckooFilter(number_of_buckets, fingerprint_size, current_level + 1);
+    while (true) {
+        // a full node stays full while keys are only inserted, so it is passed through its child pointer unlocked
+        if (current_CF->isFull()) {
+            auto *next = nextNode(current_CF, fingerprint);
+            if (next != nullptr) {
+                current_CF = next;
+                continue;
             }
-            current_CF = current_CF->child1;
         }
-        current_level++;
+
+        // parent before child, the parent lock is dropped once the child lock is taken
+        auto lock = lockNode(current_CF->current_level, fingerprint);
+        if (lock.owns_lock()) {
+            held = std::move(lock);
+        }
+        if (!current_CF->isFull()) {
+            break;
+        }
+        current_CF = childFor(current_CF, fingerprint);
     }
+    LDCF_RECORD(INSERT_DEPTH, current_CF->current_level);
 
-    auto victim = current_CF->insert(item, fingerprint);
+    auto victim = current_CF->insert(key);
     if (victim.has_value()) {
-        current_CF->child0 = new CuckooFilter(number_of_buckets, fingerprint_size, current_level + 1);
-        current_CF->child1 = new CuckooFilter(number_of_buckets, fingerprint_size, current_level + 1);
-        if (getPrefix(victim->fingerprint, current_level, current_CF->getFingerprintSize())) {
-            current_CF->child0->insert(victim.value());
-        } else {
-            current_CF->child1->insert(victim.value());
-        }
+        placeVictim(current_CF, victim.value(), lockNode, held);
     }
-    size_++;
 }
 
-// Check if an item is in the filter
-bool LogarithmicDynamicCuckooFilter::contains(const std::string &item) const {
-    CuckooFilter *current_CF = root;
-    int current_level = 0;
-    uint32_t fingerprint = CuckooFilter::hash(item);
-    fingerprint = fingerprint & ((1 << current_CF->getFingerprintSize()) - 1);
+// Push a victim down the tree until a node stores it, a victim may kick out another one in a child that is nearly full
+template <typename HashPolicy>
+template <typename LockFunction>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::placeVictim(Node *parent, Victim victim, LockFunction &lockNode,
+                                                                  std::unique_lock<std::mutex> &held) {
     while (true) {
-        if (current_CF->contains(item, fingerprint)) {
+        // only the child the victim is routed to is created, its sibling waits for a key of its own
+        auto *current_CF = childFor(parent, victim.fingerprint);
+
+        auto lock = lockNode(current_CF->current_level, victim.fingerprint);
+        if (lock.owns_lock()) {
+            held = std::move(lock);
+        }
+
+        if (!current_CF->isFull()) {
+            auto next = current_CF->insert(victim);
+            if (!next.has_value()) {
+                return;
+            }
+            victim = next.value();
+        }
+        parent = current_CF;
+    }
+}
+
+// Get the child a fingerprint is routed to, creating it if it does not exist yet
+template <typename HashPolicy>
+typename BasicLogarithmicDynamicCuckooFilter<HashPolicy>::Node *
+BasicLogarithmicDynamicCuckooFilter<HashPolicy>::childFor(Node *node, uint32_t fingerprint) {
+    auto level = node->current_level;
+    auto &child = getPrefix(fingerprint, level, fingerprint_size) ? node->child0 : node->child1;
+    auto *existing = child.load(std::memory_order_acquire);
+    if (existing == nullptr) {
+        // built completely before readers can reach it, through the routing table or the parent
+        existing = createNode(level + 1);
+        LDCF_COUNT(NODES_CREATED, 1);
+        route(level + 1, fingerprint, existing);
+        child.store(existing, std::memory_order_release);
+    }
+    return existing;
+}
+
+// The header and the zeroed slab come from their own arenas
+template <typename HashPolicy>
+typename BasicLogarithmicDynamicCuckooFilter<HashPolicy>::Node *
+BasicLogarithmicDynamicCuckooFilter<HashPolicy>::createNode(int level) {
+    auto buckets = bucketsAt(level);
+    auto *slab = static_cast<char*>(slabs.allocate(Node::slabSize(buckets, fingerprint_size, level)));
+    return new (headers.allocate(sizeof(Node))) Node(buckets, fingerprint_size, level, slab);
+}
+
+// A copied slab goes to the slab arena like a new one, a mapped one stays in the file
+template <typename HashPolicy>
+typename BasicLogarithmicDynamicCuckooFilter<HashPolicy>::Node *
+BasicLogarithmicDynamicCuckooFilter<HashPolicy>::createNode(int level, const char *slab, std::size_t items, bool accept_values, bool copy) {
+    auto buckets = bucketsAt(level);
+    if (copy) {
+        auto slab_size = Node::slabSize(buckets, fingerprint_size, level);
+        auto *copied = static_cast<char*>(slabs.allocate(slab_size));
+        memcpy(copied, slab, slab_size);
+        slab = copied;
+    }
+    return new (headers.allocate(sizeof(Node))) Node(buckets, fingerprint_size, level, slab, items, accept_values, false);
+}
+
+// Slabs in a mapped file are not the arena's
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::destroyNode(Node *node) {
+    const char *slab = node->data();
+    if (mapped_data == nullptr || slab < mapped_data || slab >= mapped_data + mapped_size) {
+        slabs.deallocate(const_cast<char*>(slab), Node::slabSize(node->getNumberOfBuckets(), fingerprint_size, node->current_level));
+    }
+    node->~Node();
+    headers.deallocate(node, sizeof(Node));
+}
+
+// Buckets of a node at a level, the growth factor compounds per level up to MAX_NODE_BUCKETS
+template <typename HashPolicy>
+std::size_t BasicLogarithmicDynamicCuckooFilter<HashPolicy>::bucketsAt(int level) const {
+    auto buckets = std::min(number_of_buckets, MAX_NODE_BUCKETS);
+    for (int l = 0; l < level; l++) {
+        if (buckets > MAX_NODE_BUCKETS / growth_factor) {
+            return MAX_NODE_BUCKETS;
+        }
+        buckets *= growth_factor;
+    }
+    return buckets;
+}
+
+// Size the routing table for the fingerprint size and put the root in it
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::initRouting() {
+    // every routed level must leave the node at least one fingerprint bit
+    routing_levels = std::min(ROUTING_LEVELS, fingerprint_size - 1);
+    routing.reset(new std::atomic<Node*>[(2ULL << routing_levels) - 1]);
+    for (std::size_t i = 0; i < (2ULL << routing_levels) - 1; i++) {
+        routing[i].store(nullptr, std::memory_order_relaxed);
+    }
+    route(0, 0, root);
+}
+
+// Enter a node in the routing table, nodes below the routed levels are only reachable through their parents
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::route(int level, uint32_t fingerprint, Node *node) {
+    if (static_cast<std::size_t>(level) > routing_levels) {
+        return;
+    }
+    // heap order, the node at level l on the path of prefix p is entry (1 << l) - 1 + p
+    auto prefix = fingerprint & ((1U << level) - 1);
+    routing[(1ULL << level) - 1 + prefix].store(node, std::memory_order_release);
+}
+
+// Get the child a fingerprint is routed to, nullptr if it does not exist
+template <typename HashPolicy>
+typename BasicLogarithmicDynamicCuckooFilter<HashPolicy>::Node *
+BasicLogarithmicDynamicCuckooFilter<HashPolicy>::nextNode(const Node *node, uint32_t fingerprint) {
+    const auto &child = getPrefix(fingerprint, node->current_level, 0) ? node->child0 : node->child1;
+    return child.load(std::memory_order_acquire);
+}
+
+// Check if a hashed item is in the filter, safe to run while one writer inserts
+template <typename HashPolicy>
+bool BasicLogarithmicDynamicCuckooFilter<HashPolicy>::contains(uint64_t hash) const {
+    LDCF_TIME(LOOKUP_LATENCY);
+    LDCF_COUNT(LOOKUPS, 1);
+    auto guard = epochs.pin();
+    // hashed once, every level reuses the same key
+    auto key = HashedKey::fromHash(hash, fingerprint_size);
+
+    // the routed levels come straight out of the table, independent loads instead of a pointer chase,
+    // so the buckets of the whole path are prefetched before the first probe
+    const Node *path[ROUTING_LEVELS + 1];
+    std::size_t depth = 0;
+    while (depth <= routing_levels) {
+        const Node *node = routing[(1ULL << depth) - 1 + (key.fingerprint & ((1U << depth) - 1))].load(std::memory_order_acquire);
+        if (node == nullptr) {
+            break;
+        }
+        node->prefetch(key);
+        path[depth++] = node;
+    }
+    bool found = false;
+    for (std::size_t i = 0; i < depth; i++) {
+        found |= path[i]->contains(key);
+    }
+    if (found || depth <= routing_levels) {
+        LDCF_RECORD(LOOKUP_PATH, depth);
+        return found;
+    }
+
+    // deeper than the table, one level at a time
+    const Node *current_CF = nextNode(path[depth - 1], key.fingerprint);
+    while (current_CF != nullptr) {
+        if (current_CF->contains(key)) {
+            LDCF_RECORD(LOOKUP_PATH, current_CF->current_level + 1);
             return true;
         }
-        if (getPrefix(fingerprint, current_level, current_CF->getFingerprintSize())) {
-            if (current_CF->child0 == nullptr) {
-                return false;
+        const Node *next = nextNode(current_CF, key.fingerprint);
+        if (next == nullptr) {
+            LDCF_RECORD(LOOKUP_PATH, current_CF->current_level + 1);
+        }
+        current_CF = next;
+    }
+    return false;
+}
+
+// Remove a hashed item from the filter
+template <typename HashPolicy>
+bool BasicLogarithmicDynamicCuckooFilter<HashPolicy>::remove(uint64_t hash) {
+    checkWritable();
+    Node *parent = nullptr;
+    Node *current_CF = root;
+    // hashed once, every level reuses the same key
+    auto key = HashedKey::fromHash(hash, fingerprint_size);
+    while (current_CF != nullptr) {
+        if (current_CF->remove(key)) {
+            size_.store(size_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+            current_CF->acceptValues(true);
+
+            // a node that got sparse enough takes its leaves back, or goes back into its parent
+            auto level = current_CF->current_level;
+            auto prefix = key.fingerprint & ((1U << level) - 1);
+            bool merged = false;
+            for (uint32_t branch : {0U, 1U << level}) {
+                merged |= mergeChild(current_CF, prefix | branch, MERGE_LOAD_FACTOR);
+            }
+            if (!merged && parent != nullptr) {
+                merged = mergeChild(parent, prefix, MERGE_LOAD_FACTOR);
             }
-            current_CF = current_CF->child0;
+            if (merged) {
+                epochs.collect();
+            }
+            return true;
+        }
+        parent = current_CF;
+        current_CF = nextNode(current_CF, key.fingerprint);
+    }
+    return false;
+}
+
+// Merge sparse leaves back into their parents
+template <typename HashPolicy>
+std::size_t BasicLogarithmicDynamicCuckooFilter<HashPolicy>::compact() {
+    checkWritable();
+    auto freed = compactSubtree(root, 0);
+    epochs.collect();
+    return freed;
+}
+
+// Merge the leaves below a node, children first so the node can become a leaf itself
+template <typename HashPolicy>
+std::size_t BasicLogarithmicDynamicCuckooFilter<HashPolicy>::compactSubtree(Node *node, uint32_t prefix) {
+    std::size_t freed = 0;
+    auto branch = 1U << node->current_level;
+    for (auto child_prefix : {prefix, prefix | branch}) {
+        auto *child = nextNode(node, child_prefix);
+        if (child != nullptr) {
+            freed += compactSubtree(child, child_prefix);
+            freed += mergeChild(node, child_prefix, 1.0) ? 1 : 0;
+        }
+    }
+    return freed;
+}
+
+// Copy the fingerprints of a leaf into its parent and free the leaf
+template <typename HashPolicy>
+bool BasicLogarithmicDynamicCuckooFilter<HashPolicy>::mergeChild(Node *parent, uint32_t prefix, double max_load) {
+    auto &link = getPrefix(prefix, parent->current_level, fingerprint_size) ? parent->child0 : parent->child1;
+    auto *child = link.load(std::memory_order_relaxed);
+    if (child == nullptr || child->child0.load(std::memory_order_relaxed) != nullptr ||
+        child->child1.load(std::memory_order_relaxed) != nullptr ||
+        static_cast<double>(parent->size() + child->size()) > max_load * parent->capacity()) {
+        return false;
+    }
+
+    // the child keeps the bits above its level, the prefix gives back the ones below
+    std::vector<Victim> copied;
+    copied.reserve(child->size());
+    bool fits = true;
+    auto level = child->current_level;
+    child->forEachFingerprint([&](std::size_t index, uint32_t stored) {
+        auto victim = Victim{(stored << level) | prefix, static_cast<uint32_t>(index)};
+        if (fits && !parent->insert(victim).has_value()) {
+            copied.push_back(victim);
         } else {
-            if (current_CF->child1 == nullptr) {
-                return false;
+            fits = false;
+        }
+    });
+    if (!fits) {
+        // the child still holds all of them, the copies can go first
+        for (const auto &victim : copied) {
+            parent->remove(HashedKey{static_cast<uint64_t>(victim.index) << 32, victim.fingerprint});
+        }
+        parent->acceptValues(true);
+        return false;
+    }
+
+    // readers that still hold the child find everything in the parent too
+    route(level, prefix, nullptr);
+    link.store(nullptr, std::memory_order_release);
+    epochs.retire([this, child]() { destroyNode(child); });
+    parent->acceptValues(true);
+    LDCF_COUNT(NODES_MERGED, 1);
+    return true;
+}
+
+// Hash every item of a batch up front
+template <typename HashPolicy>
+template <typename Items>
+std::vector<uint64_t> BasicLogarithmicDynamicCuckooFilter<HashPolicy>::hashBatch(const Items &items) {
+    std::vector<uint64_t> hashes;
+    hashes.reserve(items.size());
+    for (const auto &item : items) {
+        hashes.push_back(HashPolicy::hash(item));
+    }
+    return hashes;
+}
+
+// Insert a batch of items
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::insert_batch(const std::vector<std::string> &items) {
+    auto hashes = hashBatch(items);
+    insert_batch(hashes.data(), hashes.size());
+}
+
+// Insert a batch of items without copying them
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::insert_batch(const std::vector<std::string_view> &items) {
+    auto hashes = hashBatch(items);
+    insert_batch(hashes.data(), hashes.size());
+}
+
+// Insert a batch of hashed items, prefetching the buckets of a window of keys before inserting them
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::insert_batch(const uint64_t *hashes, std::size_t count) {
+    checkWritable();
+    HashedKey keys[BATCH_WINDOW];
+    for (std::size_t start = 0; start < count; start += BATCH_WINDOW) {
+        auto window = std::min(BATCH_WINDOW, count - start);
+        for (std::size_t i = 0; i < window; i++) {
+            keys[i] = HashedKey::fromHash(hashes[start + i], fingerprint_size);
+
+            // walk to the node the key will most likely land in, inserts earlier in the window may still fill it
+            const Node *current_CF = root;
+            while (current_CF->isFull()) {
+                const Node *next = nextNode(current_CF, keys[i].fingerprint);
+                if (next == nullptr) {
+                    break;
+                }
+                current_CF = next;
             }
-            current_CF = current_CF->child1;
+            current_CF->prefetch(keys[i]);
         }
-        current_level++;
+        for (std::size_t i = 0; i < window; i++) {
+            insertKey(keys[i]);
+        }
+        size_.store(size_.load(std::memory_order_relaxed) + window, std::memory_order_relaxed);
     }
 }
 
-// Remove an item from the filter
-bool LogarithmicDynamicCuckooFilter::remove(const std::string &item) {
-    CuckooFilter *current_CF = root;
-    int current_level = 0;
-    uint32_t fingerprint = CuckooFilter::hash(item);
-    fingerprint = fingerprint & ((1 << current_CF->getFingerprintSize()) - 1);
-    while (true) {
-        if (current_CF->contains(item, fingerprint)) {
-            size_--;
-            current_CF->acceptValues(true);
-            return current_CF->remove(item, fingerprint);
+// Insert a batch of items from several threads
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::insert_parallel(const std::vector<std::string> &items, std::size_t threads) {
+    auto hashes = hashBatch(items);
+    insert_parallel(hashes.data(), hashes.size(), threads);
+}
+
+// Insert a batch of items from several threads without copying them
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::insert_parallel(const std::vector<std::string_view> &items, std::size_t threads) {
+    auto hashes = hashBatch(items);
+    insert_parallel(hashes.data(), hashes.size(), threads);
+}
+
+// Insert hashed items from several threads, keys are sharded by the low fingerprint bits that route them,
+// so below the shard depth every subtree has a single writer and only the shared top levels are locked
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::insert_parallel(const uint64_t *hashes, std::size_t count, std::size_t threads) {
+    checkWritable();
+    if (threads <= 1 || count < threads * BATCH_WINDOW) {
+        insert_batch(hashes, count);
+        return;
+    }
+
+    // a few shards per thread keep the threads busy when the keys are skewed
+    std::size_t shard_bits = 2;
+    while ((1ULL << shard_bits) < threads * 4) {
+        shard_bits++;
+    }
+    shard_bits = std::min(shard_bits, fingerprint_size - 1);
+    std::size_t shards = 1ULL << shard_bits;
+    uint32_t shard_mask = static_cast<uint32_t>(shards - 1);
+
+    // counting sort of the keys by shard, the fingerprint is the low bits of the hash
+    std::vector<std::size_t> offsets(shards + 1, 0);
+    for (std::size_t i = 0; i < count; i++) {
+        offsets[(hashes[i] & shard_mask) + 1]++;
+    }
+    for (std::size_t shard = 0; shard < shards; shard++) {
+        offsets[shard + 1] += offsets[shard];
+    }
+    std::vector<uint64_t> sharded(count);
+    std::vector<std::size_t> next(offsets.begin(), offsets.end() - 1);
+    for (std::size_t i = 0; i < count; i++) {
+        sharded[next[hashes[i] & shard_mask]++] = hashes[i];
+    }
+
+    // one lock per node down to the shard depth, heap ordered: a node at level l routed by prefix p is (1 << l) - 1 + p
+    std::vector<std::mutex> locks((2ULL << shard_bits) - 1);
+    auto lockNode = [&](int level, uint32_t fingerprint) {
+        if (static_cast<std::size_t>(level) > shard_bits) {
+            return std::unique_lock<std::mutex>();
         }
-        if (getPrefix(fingerprint, current_CF->current_level, current_CF->getFingerprintSize())) {
-            if (current_CF->child0 == nullptr) {
-                return false;
+        auto prefix = fingerprint & ((1U << level) - 1);
+        return std::unique_lock<std::mutex>(locks[(1ULL << level) - 1 + prefix]);
+    };
+
+    std::atomic<std::size_t> next_shard{0};
+    auto worker = [&]() {
+        for (auto shard = next_shard++; shard < shards; shard = next_shard++) {
+            for (auto i = offsets[shard]; i < offsets[shard + 1]; i++) {
+                insertKey(HashedKey::fromHash(sharded[i], fingerprint_size), lockNode);
             }
-            current_CF = current_CF->child0;
-        } else {
-            if (current_CF->child1 == nullptr) {
-                return false;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (std::size_t t = 1; t < threads; t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : pool) {
+        thread.join();
+    }
+    size_.store(size_.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+}
+
+// Check a batch of items
+template <typename HashPolicy>
+std::vector<uint64_t> BasicLogarithmicDynamicCuckooFilter<HashPolicy>::contains_batch(const std::vector<std::string> &items) const {
+    auto hashes = hashBatch(items);
+    std::vector<uint64_t> results((items.size() + 63) / 64, 0);
+    contains_batch(hashes.data(), hashes.size(), results.data());
+    return results;
+}
+
+// Check a batch of items without copying them
+template <typename HashPolicy>
+std::vector<uint64_t> BasicLogarithmicDynamicCuckooFilter<HashPolicy>::contains_batch(const std::vector<std::string_view> &items) const {
+    auto hashes = hashBatch(items);
+    std::vector<uint64_t> results((items.size() + 63) / 64, 0);
+    contains_batch(hashes.data(), hashes.size(), results.data());
+    return results;
+}
+
+// Check a batch of hashed items level by level, every key of a window has its buckets
+// prefetched before the first of them is probed, so the cache misses overlap
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::contains_batch(const uint64_t *hashes, std::size_t count, uint64_t *results) const {
+    LDCF_COUNT(LOOKUPS, count);
+    auto guard = epochs.pin();
+    std::fill(results, results + (count + 63) / 64, 0);
+
+    HashedKey keys[BATCH_WINDOW];
+    const Node *nodes[BATCH_WINDOW];
+    for (std::size_t start = 0; start < count; start += BATCH_WINDOW) {
+        auto window = std::min(BATCH_WINDOW, count - start);
+        for (std::size_t i = 0; i < window; i++) {
+            keys[i] = HashedKey::fromHash(hashes[start + i], fingerprint_size);
+            nodes[i] = root;
+        }
+
+        // every pass probes one level, keys that are found or fall off the tree drop out
+        auto active = window;
+        while (active > 0) {
+            for (std::size_t i = 0; i < window; i++) {
+                if (nodes[i] != nullptr) {
+                    nodes[i]->prefetch(keys[i]);
+                }
+            }
+            for (std::size_t i = 0; i < window; i++) {
+                if (nodes[i] == nullptr) {
+                    continue;
+                }
+                if (nodes[i]->contains(keys[i])) {
+                    LDCF_RECORD(LOOKUP_PATH, nodes[i]->current_level + 1);
+                    auto position = start + i;
+                    results[position / 64] |= 1ULL << (position % 64);
+                    nodes[i] = nullptr;
+                } else {
+                    const Node *next = nextNode(nodes[i], keys[i].fingerprint);
+                    if (next == nullptr) {
+                        LDCF_RECORD(LOOKUP_PATH, nodes[i]->current_level + 1);
+                    }
+                    nodes[i] = next;
+                }
+                if (nodes[i] == nullptr) {
+                    active--;
+                }
+            }
+        }
+    }
+}
+
+// Bytes allocated by all nodes of the tree
+template <typename HashPolicy>
+std::size_t BasicLogarithmicDynamicCuckooFilter<HashPolicy>::memoryUsage() const {
+    std::size_t bytes = sizeof(BasicLogarithmicDynamicCuckooFilter) + ((2ULL << routing_levels) - 1) * sizeof(std::atomic<Node*>);
+    std::vector<const Node*> stack{root};
+    while (!stack.empty()) {
+        const auto *current_CF = stack.back();
+        stack.pop_back();
+        bytes += current_CF->memoryUsage();
+        for (const auto *child : {current_CF->child0.load(std::memory_order_acquire), current_CF->child1.load(std::memory_order_acquire)}) {
+            if (child != nullptr) {
+                stack.push_back(child);
+            }
+        }
+    }
+    return bytes;
+}
+
+// Items the allocated nodes hold
+template <typename HashPolicy>
+std::size_t BasicLogarithmicDynamicCuckooFilter<HashPolicy>::capacity() const {
+    auto guard = epochs.pin();
+    std::size_t items = 0;
+    std::vector<const Node*> stack{root};
+    while (!stack.empty()) {
+        const auto *current_CF = stack.back();
+        stack.pop_back();
+        items += current_CF->capacity();
+        for (const auto *child : {current_CF->child0.load(std::memory_order_acquire), current_CF->child1.load(std::memory_order_acquire)}) {
+            if (child != nullptr) {
+                stack.push_back(child);
+            }
+        }
+    }
+    return items;
+}
+
+// Describe the tree
+template <typename HashPolicy>
+FilterStats BasicLogarithmicDynamicCuckooFilter<HashPolicy>::stats() const {
+    auto guard = epochs.pin();
+    FilterStats stats;
+    stats.items = size();
+    auto root_stats = collectStats(root, fingerprint_size, stats);
+    stats.mean_path_length = root_stats.first;
+    stats.false_positive_rate = root_stats.second;
+
+    stats.filter_overhead_bytes = sizeof(BasicLogarithmicDynamicCuckooFilter) + ((2ULL << routing_levels) - 1) * sizeof(std::atomic<Node*>);
+    stats.total_bytes = stats.filter_overhead_bytes + stats.node_overhead_bytes + stats.fingerprint_bytes +
+                        stats.occupancy_bytes + stats.padding_bytes;
+    stats.reserved_bytes = headers.reserved() + slabs.reserved();
+    stats.bits_per_item = stats.items == 0 ? 0 : static_cast<double>(stats.total_bytes) * BYTE_SIZE / stats.items;
+    return stats;
+}
+
+// Write the tree to a file
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::save(const std::string &path) const {
+    if (!hostIsLittleEndian()) {
+        throw std::runtime_error("Saving a filter needs a little-endian host");
+    }
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Could not open the file " + path);
+    }
+
+    // the header is written last, once the checksum is known
+    char header[FILE_HEADER_SIZE] = {};
+    file.write(header, FILE_HEADER_SIZE);
+
+    uint64_t checksum = 0;
+    std::size_t nodes = 0;
+    std::vector<const Node*> stack{root};
+    while (!stack.empty()) {
+        const auto *current_CF = stack.back();
+        stack.pop_back();
+        const auto *child0 = current_CF->child0.load(std::memory_order_acquire);
+        const auto *child1 = current_CF->child1.load(std::memory_order_acquire);
+
+        uint32_t flags = (child0 != nullptr ? NODE_HAS_CHILD0 : 0) | (child1 != nullptr ? NODE_HAS_CHILD1 : 0) |
+                         (current_CF->acceptsValues() ? NODE_ACCEPTS_VALUES : 0);
+        auto slab_size = Node::slabSize(current_CF->getNumberOfBuckets(), fingerprint_size, current_CF->current_level);
+
+        Victim stashed[STASH_SIZE];
+        auto stash_count = current_CF->stashed(stashed);
+
+        char record[NODE_HEADER_SIZE] = {};
+        putLittleEndian(record, static_cast<uint32_t>(current_CF->current_level), 4);
+        putLittleEndian(record + 4, flags, 4);
+        putLittleEndian(record + 8, current_CF->size() - stash_count, 8);
+        putLittleEndian(record + 16, slab_size, 8);
+        putLittleEndian(record + 24, stash_count, 4);
+        for (std::size_t i = 0; i < stash_count; i++) {
+            putLittleEndian(record + 32 + i * 8, stashed[i].fingerprint, 4);
+            putLittleEndian(record + 36 + i * 8, stashed[i].index, 4);
+        }
+        file.write(record, NODE_HEADER_SIZE);
+        file.write(current_CF->data(), static_cast<std::streamsize>(slab_size));
+        checksum = WyHashPolicy::hashBytes(record, NODE_HEADER_SIZE, checksum);
+        checksum = WyHashPolicy::hashBytes(current_CF->data(), slab_size, checksum);
+        nodes++;
+
+        // pre-order, child0 comes out of the stack first
+        if (child1 != nullptr) {
+            stack.push_back(child1);
+        }
+        if (child0 != nullptr) {
+            stack.push_back(child0);
+        }
+    }
+
+    memcpy(header, FILE_MAGIC, sizeof(FILE_MAGIC));
+    putLittleEndian(header + 8, FILE_FORMAT_VERSION, 4);
+    putLittleEndian(header + 12, FILE_HEADER_SIZE, 4);
+    putLittleEndian(header + 16, policyTag<HashPolicy>(), 8);
+    putLittleEndian(header + 24, number_of_buckets, 8);
+    putLittleEndian(header + 32, fingerprint_size, 8);
+    putLittleEndian(header + 40, size(), 8);
+    putLittleEndian(header + 48, nodes, 8);
+    putLittleEndian(header + 56, checksum, 8);
+    putLittleEndian(header + 64, growth_factor, 8);
+    file.seekp(0);
+    file.write(header, FILE_HEADER_SIZE);
+
+    if (!file.flush()) {
+        throw std::runtime_error("Could not write the file " + path);
+    }
+}
+
+// Read a saved filter into memory
+template <typename HashPolicy>
+std::unique_ptr<BasicLogarithmicDynamicCuckooFilter<HashPolicy>>
+BasicLogarithmicDynamicCuckooFilter<HashPolicy>::load(const std::string &path) {
+    std::unique_ptr<BasicLogarithmicDynamicCuckooFilter> filter(new BasicLogarithmicDynamicCuckooFilter());
+    filter->mapFile(path);
+    filter->readTree(true, true);
+    // the nodes hold copies, the file is not needed any more
+    filter->unmapFile();
+    return filter;
+}
+
+// Query a saved filter straight out of the page cache
+template <typename HashPolicy>
+std::unique_ptr<BasicLogarithmicDynamicCuckooFilter<HashPolicy>>
+BasicLogarithmicDynamicCuckooFilter<HashPolicy>::open_mapped(const std::string &path, bool verify_checksum) {
+    std::unique_ptr<BasicLogarithmicDynamicCuckooFilter> filter(new BasicLogarithmicDynamicCuckooFilter());
+    filter->mapFile(path);
+    filter->readTree(false, verify_checksum);
+    filter->read_only = true;
+    // queries jump around the slabs
+    madvise(const_cast<char*>(filter->mapped_data), filter->mapped_size, MADV_RANDOM);
+    return filter;
+}
+
+// Mapped filters are read-only, their slabs are in read-only pages
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::checkWritable() const {
+    if (read_only) {
+        throw std::runtime_error("A filter opened with open_mapped is read-only");
+    }
+}
+
+// Map a saved filter read-only
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::mapFile(const std::string &path) {
+    if (!hostIsLittleEndian()) {
+        throw std::runtime_error("Loading a filter needs a little-endian host");
+    }
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open the file " + path);
+    }
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw std::runtime_error("Could not stat the file " + path);
+    }
+    auto size = static_cast<std::size_t>(file_stat.st_size);
+    if (size < VERSION_1_HEADER_SIZE) {
+        close(fd);
+        throw std::runtime_error("Not a saved filter: " + path);
+    }
+    // shared, so every process that maps the file uses the same page cache
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Could not map the file " + path);
+    }
+    mapped_data = static_cast<const char*>(mapped);
+    mapped_size = size;
+}
+
+// Unmap the saved filter
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::unmapFile() {
+    if (mapped_data != nullptr) {
+        munmap(const_cast<char*>(mapped_data), mapped_size);
+        mapped_data = nullptr;
+        mapped_size = 0;
+    }
+}
+
+// Check the header of the mapped file and rebuild the tree from its node records
+template <typename HashPolicy>
+void BasicLogarithmicDynamicCuckooFilter<HashPolicy>::readTree(bool copy, bool verify_checksum) {
+    const char *header = mapped_data;
+    if (memcmp(header, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) {
+        throw std::runtime_error("Not a saved filter");
+    }
+    auto version = getLittleEndian(header + 8, 4);
+    auto header_size = version == 1 ? VERSION_1_HEADER_SIZE : FILE_HEADER_SIZE;
+    if (version == 0 || version > FILE_FORMAT_VERSION || getLittleEndian(header + 12, 4) != header_size ||
+        mapped_size < header_size) {
+        throw std::runtime_error("Unsupported filter format version " + std::to_string(version));
+    }
+    if (getLittleEndian(header + 16, 8) != policyTag<HashPolicy>()) {
+        throw std::runtime_error(std::string("The filter was not saved with the ") + HashPolicy::name + " hash policy");
+    }
+    number_of_buckets = getLittleEndian(header + 24, 8);
+    fingerprint_size = getLittleEndian(header + 32, 8);
+    auto items = getLittleEndian(header + 40, 8);
+    auto nodes = getLittleEndian(header + 48, 8);
+    auto checksum = getLittleEndian(header + 56, 8);
+    growth_factor = version == 1 ? 1 : getLittleEndian(header + 64, 8);
+    if (number_of_buckets == 0 || fingerprint_size == 0 || fingerprint_size > BYTE_SIZE * 4 ||
+        growth_factor == 0 || (growth_factor & (growth_factor - 1)) != 0) {
+        throw std::runtime_error("Corrupt filter header");
+    }
+
+    // pre-order: a node is followed by the subtree of child0, then the subtree of child1
+    struct PendingNode {
+        std::atomic<Node*> *slot;
+        int level;
+        uint32_t prefix;
+    };
+    std::atomic<Node*> root_slot{nullptr};
+    std::vector<PendingNode> pending{{&root_slot, 0, 0}};
+    uint64_t running_checksum = 0;
+    std::size_t offset = header_size;
+    std::size_t nodes_read = 0;
+    try {
+        while (!pending.empty()) {
+            auto next = pending.back();
+            pending.pop_back();
+            if (nodes_read == nodes || mapped_size - offset < NODE_HEADER_SIZE) {
+                throw std::runtime_error("Truncated filter file");
+            }
+
+            const char *record = mapped_data + offset;
+            auto level = static_cast<int>(getLittleEndian(record, 4));
+            auto flags = static_cast<uint32_t>(getLittleEndian(record + 4, 4));
+            auto node_items = getLittleEndian(record + 8, 8);
+            auto slab_size = getLittleEndian(record + 16, 8);
+            auto stash_count = static_cast<std::size_t>(getLittleEndian(record + 24, 4));
+            if (level != next.level || static_cast<std::size_t>(level) >= fingerprint_size || stash_count > STASH_SIZE ||
+                slab_size != Node::slabSize(bucketsAt(level), fingerprint_size, level) ||
+                mapped_size - offset - NODE_HEADER_SIZE < slab_size) {
+                throw std::runtime_error("Corrupt node record at byte " + std::to_string(offset));
+            }
+
+            const char *slab = record + NODE_HEADER_SIZE;
+            if (verify_checksum) {
+                running_checksum = WyHashPolicy::hashBytes(record, NODE_HEADER_SIZE, running_checksum);
+                running_checksum = WyHashPolicy::hashBytes(slab, slab_size, running_checksum);
+            }
+            auto *node = createNode(level, slab, node_items, (flags & NODE_ACCEPTS_VALUES) != 0, copy);
+            next.slot->store(node, std::memory_order_relaxed);
+            Victim stashed[STASH_SIZE];
+            for (std::size_t i = 0; i < stash_count; i++) {
+                stashed[i] = Victim{static_cast<uint32_t>(getLittleEndian(record + 32 + i * 8, 4)),
+                                    static_cast<uint32_t>(getLittleEndian(record + 36 + i * 8, 4))};
+            }
+            node->restoreStash(stashed, stash_count);
+            if (next.level == 0) {
+                root = node;
+                initRouting();
+            } else {
+                route(next.level, next.prefix, node);
+            }
+            offset += NODE_HEADER_SIZE + slab_size;
+            nodes_read++;
+
+            if ((flags & NODE_HAS_CHILD1) != 0) {
+                pending.push_back({&node->child1, level + 1, next.prefix | (1U << level)});
             }
-            current_CF = current_CF->child1;
+            if ((flags & NODE_HAS_CHILD0) != 0) {
+                pending.push_back({&node->child0, level + 1, next.prefix});
+            }
+        }
+        if (nodes_read != nodes) {
+            throw std::runtime_error("Corrupt filter header");
+        }
+        if (verify_checksum && running_checksum != checksum) {
+            throw std::runtime_error("Filter checksum mismatch");
         }
-        current_level++;
+    } catch (...) {
+        // the nodes read so far stay in the arenas until the filter is destroyed
+        root = nullptr;
+        throw;
     }
+
+    size_.store(items, std::memory_order_relaxed);
 }
 
-bool LogarithmicDynamicCuckooFilter::getPrefix(std::size_t fingerprint, int current_level, std::size_t fingerprintSize) {
+template <typename HashPolicy>
+bool BasicLogarithmicDynamicCuckooFilter<HashPolicy>::getPrefix(std::size_t fingerprint, int current_level, std::size_t fingerprintSize) {
     // put the one to the position of the current level
     uint32_t mask = 1 << current_level;
     return (fingerprint & mask) == 0;
-}
\ No newline at end of file
+}
+
+template class BasicLogarithmicDynamicCuckooFilter<StdHashPolicy>;
+template class BasicLogarithmicDynamicCuckooFilter<WyHashPolicy>;
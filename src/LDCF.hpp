@@ -5,14 +5,40 @@
 #include <cstdint>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <atomic>
+#include <memory>
 #include <optional>
+#include <mutex>
 
 #include "CF.hpp"
+#include "Epoch.hpp"
+#include "NodeArena.hpp"
+#include "FilterStats.hpp"
+
+// Number of keys whose buckets are prefetched together by the batch operations
+const std::size_t BATCH_WINDOW = 16;
+
+// remove merges a leaf into its parent once both together fill at most this share of the parent's capacity
+const double MERGE_LOAD_FACTOR = 0.5;
+
+// Levels below the root whose nodes are found through the routing table instead of child pointers
+const std::size_t ROUTING_LEVELS = 8;
+
+// Largest node a growth factor leads to, bucket indices are the high 32 bits of a key's hash
+const std::size_t MAX_NODE_BUCKETS = 1ULL << 32;
 
 /**
  * A logarithmic dynamic cuckoo filter implementation.
+ * 
+ * Any number of threads may call contains, contains_batch and size while one thread inserts or removes.
+ * Readers never take a lock: children are published atomically, a probe that overlapped a write to the same
+ * node is repeated, and nodes taken out of the tree are only freed once every reader has left them.
+ * 
+ * @tparam HashPolicy Hashes keys and fingerprints, see Hash.hpp.
  */
-class LogarithmicDynamicCuckooFilter {
+template <typename HashPolicy = DefaultHashPolicy>
+class BasicLogarithmicDynamicCuckooFilter {
 public:
     /**
      * Constructor.
@@ -20,20 +46,40 @@ public:
      * @param false_positive_rate The desired false positive rate.
      * @param set_size The expected number of items in the set.
      * @param expected_levels The expected number of levels in the filter.
+     * @param growth_factor Each level's nodes have this many times the buckets of their parent, a power of two.
+     *                      1 keeps every node the size of the root; 2 or more keeps the tree shallow when the set
+     *                      grows far past set_size, at the cost of emptier new nodes.
+     * @throws std::runtime_error if growth_factor is not a power of two.
      */
-    LogarithmicDynamicCuckooFilter(double false_positive_rate, std::size_t set_size, std::size_t expected_levels);
+    BasicLogarithmicDynamicCuckooFilter(double false_positive_rate, std::size_t set_size, std::size_t expected_levels,
+                                        std::size_t growth_factor = 1);
 
     /**
      * Destructor.
      */
-    ~LogarithmicDynamicCuckooFilter();
+    ~BasicLogarithmicDynamicCuckooFilter();
 
     /**
      * Insert an item into the filter.
      * 
      * @param item The item to insert.
      */
-    void insert(const std::string &item);
+    void insert(std::string_view item) { insert(HashPolicy::hash(item)); }
+
+    /**
+     * Insert a byte range into the filter, for example a slice of a read buffer.
+     * 
+     * @param data The first byte of the item.
+     * @param length The number of bytes.
+     */
+    void insert(const void *data, std::size_t length) { insert(toView(data, length)); }
+
+    /**
+     * Insert an already hashed item into the filter.
+     * 
+     * @param hash The 64-bit hash of the item, for example a k-mer or minimizer hash. It must be well mixed.
+     */
+    void insert(uint64_t hash);
 
     /**
      * Check if an item is in the filter.
@@ -41,7 +87,24 @@ public:
      * @param item The item to check.
      * @return True if the item is in the filter, false otherwise.
      */
-    [[nodiscard]] bool contains(const std::string &item) const;
+    [[nodiscard]] bool contains(std::string_view item) const { return contains(HashPolicy::hash(item)); }
+
+    /**
+     * Check if a byte range is in the filter.
+     * 
+     * @param data The first byte of the item.
+     * @param length The number of bytes.
+     * @return True if the item is in the filter, false otherwise.
+     */
+    [[nodiscard]] bool contains(const void *data, std::size_t length) const { return contains(toView(data, length)); }
+
+    /**
+     * Check if an already hashed item is in the filter.
+     * 
+     * @param hash The 64-bit hash of the item.
+     * @return True if the item is in the filter, false otherwise.
+     */
+    [[nodiscard]] bool contains(uint64_t hash) const;
 
     /**
      * Remove an item from the filter.
@@ -49,29 +112,393 @@ public:
      * @param item The item to remove.
      * @return True if the item was removed, false otherwise.
      */
-    bool remove(const std::string &item);
+    bool remove(std::string_view item) { return remove(HashPolicy::hash(item)); }
+
+    /**
+     * Remove a byte range from the filter.
+     * 
+     * @param data The first byte of the item.
+     * @param length The number of bytes.
+     * @return True if the item was removed, false otherwise.
+     */
+    bool remove(const void *data, std::size_t length) { return remove(toView(data, length)); }
+
+    /**
+     * Remove an already hashed item from the filter.
+     * 
+     * @param hash The 64-bit hash of the item.
+     * @return True if the item was removed, false otherwise.
+     */
+    bool remove(uint64_t hash);
+
+    /**
+     * Shrink the tree to the items it holds.
+     * 
+     * Leaves are merged into their parents bottom up, so a parent left without children can be merged into
+     * its own parent in the same call: their fingerprints are copied back up as long as the parent stays
+     * within its capacity, then the leaf is unlinked and freed once no reader can see it. remove does the
+     * same for the nodes it touches when they fall below MERGE_LOAD_FACTOR. No other writer may run meanwhile.
+     * 
+     * @return The number of nodes freed.
+     */
+    std::size_t compact();
+
+    /**
+     * Mix an integer key, such as a packed k-mer, into a hash for the 64-bit overloads.
+     * 
+     * @param item The integer key.
+     * @return The 64-bit hash of the key.
+     */
+    static uint64_t hash(uint64_t item) { return HashPolicy::hash(item); }
+
+    /**
+     * Insert a batch of items.
+     * 
+     * The items are hashed first, then inserted a window at a time with the buckets they land in prefetched.
+     * 
+     * @param items The items to insert.
+     */
+    void insert_batch(const std::vector<std::string> &items);
+
+    /**
+     * Insert a batch of items that point into caller owned buffers.
+     * 
+     * @param items The items to insert.
+     */
+    void insert_batch(const std::vector<std::string_view> &items);
+
+    /**
+     * Insert a batch of already hashed items.
+     * 
+     * @param hashes The 64-bit hashes of the items.
+     * @param count The number of hashes.
+     */
+    void insert_batch(const uint64_t *hashes, std::size_t count);
+
+    /**
+     * Insert a batch of items from several threads.
+     * 
+     * The keys are sharded by the fingerprint bits that route them through the tree. Each thread takes whole
+     * shards, so the subtrees below the shard depth only ever have one writer; the few nodes above it are
+     * locked. Readers must not run concurrently with this call.
+     * 
+     * @param items The items to insert.
+     * @param threads The number of threads to use, the calling thread included.
+     */
+    void insert_parallel(const std::vector<std::string> &items, std::size_t threads);
+
+    /**
+     * Insert a batch of items that point into caller owned buffers from several threads.
+     * 
+     * @param items The items to insert.
+     * @param threads The number of threads to use, the calling thread included.
+     */
+    void insert_parallel(const std::vector<std::string_view> &items, std::size_t threads);
+
+    /**
+     * Insert a batch of already hashed items from several threads.
+     * 
+     * @param hashes The 64-bit hashes of the items.
+     * @param count The number of hashes.
+     * @param threads The number of threads to use, the calling thread included.
+     */
+    void insert_parallel(const uint64_t *hashes, std::size_t count, std::size_t threads);
+
+    /**
+     * Check a batch of items.
+     * 
+     * The items are hashed first, then probed a window at a time, level by level, with both candidate
+     * buckets of every item in the window prefetched before any of them is probed.
+     * 
+     * @param items The items to check.
+     * @return Bitmap of the results, bit i % 64 of word i / 64 is set if items[i] is in the filter.
+     */
+    [[nodiscard]] std::vector<uint64_t> contains_batch(const std::vector<std::string> &items) const;
+
+    /**
+     * Check a batch of items that point into caller owned buffers.
+     * 
+     * @param items The items to check.
+     * @return Bitmap of the results, bit i % 64 of word i / 64 is set if items[i] is in the filter.
+     */
+    [[nodiscard]] std::vector<uint64_t> contains_batch(const std::vector<std::string_view> &items) const;
+
+    /**
+     * Check a batch of already hashed items.
+     * 
+     * @param hashes The 64-bit hashes of the items.
+     * @param count The number of hashes.
+     * @param results Bitmap of (count + 63) / 64 words, bit i % 64 of word i / 64 is set if hashes[i] is in the filter.
+     */
+    void contains_batch(const uint64_t *hashes, std::size_t count, uint64_t *results) const;
+
+    /**
+     * Save the filter to a file.
+     * 
+     * The file holds a versioned header, the tree shape and every node's packed buckets, in a little-endian
+     * layout with a checksum. Bucket slabs are cache line aligned in the file so it can be mapped and probed
+     * in place by open_mapped. No writer may run meanwhile.
+     * 
+     * @param path The file to write.
+     * @throws std::runtime_error if the file can not be written.
+     */
+    void save(const std::string &path) const;
+
+    /**
+     * Read a filter written by save into memory.
+     * 
+     * @param path The file to read.
+     * @return The filter, it can be modified like a newly built one.
+     * @throws std::runtime_error if the file is missing, corrupt, of another format version or hash policy.
+     */
+    static std::unique_ptr<BasicLogarithmicDynamicCuckooFilter> load(const std::string &path);
+
+    /**
+     * Open a filter written by save for queries, straight out of the mapped file.
+     * 
+     * Nothing is copied, so opening takes time independent of the filter size and processes that map the same
+     * file share its page cache. The filter is read-only, insert and remove throw.
+     * 
+     * @param path The file to map, it must stay unchanged while the filter is open.
+     * @param verify_checksum True to read the whole file once and check the checksum.
+     * @return The filter.
+     * @throws std::runtime_error if the file is missing, corrupt, of another format version or hash policy.
+     */
+    static std::unique_ptr<BasicLogarithmicDynamicCuckooFilter> open_mapped(const std::string &path, bool verify_checksum = false);
 
     /**
      * Get the filter's size.
      * 
      * @return The number of items in the filter.
      */
-    [[nodiscard]] std::size_t size() const { return size_; }
+    [[nodiscard]] std::size_t size() const { return size_.load(std::memory_order_relaxed); }
 
     /**
      * Get the filter's capacity.
      * 
-     * @return The maximum number of items the filter can hold.
+     * The tree grows past it by adding nodes, it is how many items fit before the next node is needed.
+     * 
+     * @return The sum of the capacities of every node in the tree.
      */
     [[nodiscard]] std::size_t capacity() const;
 
+    /**
+     * Get the growth factor.
+     * 
+     * @return How many times the buckets of its parent a node has.
+     */
+    [[nodiscard]] std::size_t growthFactor() const { return growth_factor; }
+
+    /**
+     * Get the number of bytes allocated by the filter.
+     * 
+     * @return The sum of memoryUsage() over every node in the tree.
+     */
+    [[nodiscard]] std::size_t memoryUsage() const;
+
+    /**
+     * Describe the filter: nodes per level, the load of every node, where the bytes go, bits per item,
+     * the number of nodes a lookup probes and the false positive rate expected from the current loads.
+     * 
+     * No writer may run meanwhile, like save.
+     * 
+     * @return The stats, FilterStats::toJson writes them for monitoring.
+     */
+    [[nodiscard]] FilterStats stats() const;
+
 private:
-    std::size_t size_;
+    using Node = BasicCuckooFilter<HashPolicy>;
 
+    std::atomic<std::size_t> size_;
+
+    // buckets of the root, a node at level l has number_of_buckets * growth_factor^l
     std::size_t number_of_buckets;
+    std::size_t growth_factor;
     std::size_t fingerprint_size;
 
-    CuckooFilter* root;
+    // node headers packed together, so walking the tree touches few lines, and the bucket slabs; declared
+    // before epochs so retired nodes can still go back to them
+    NodeArena headers;
+    NodeArena slabs;
+
+    Node* root;
+
+    // nodes of the top routing_levels + 1 levels in heap order, the node at level l on the path of
+    // fingerprint f is routing[(1 << l) - 1 + (f & ((1 << l) - 1))], nullptr where the tree ends
+    std::unique_ptr<std::atomic<Node*>[]> routing;
+    std::size_t routing_levels;
+
+    // readers pin an epoch, nodes unlinked by the writer are retired here
+    mutable EpochManager epochs;
+
+    // the file behind a filter from open_mapped, or while load reads it
+    const char *mapped_data;
+    std::size_t mapped_size;
+    bool read_only;
+
+    /**
+     * Constructor of an empty filter without a root, for load and open_mapped.
+     */
+    BasicLogarithmicDynamicCuckooFilter();
+
+    /**
+     * Throw if the filter is mapped read-only.
+     */
+    void checkWritable() const;
+
+    /**
+     * Map a saved filter read-only.
+     * 
+     * @param path The file to map.
+     */
+    void mapFile(const std::string &path);
+
+    /**
+     * Unmap the file mapped by mapFile, if any.
+     */
+    void unmapFile();
+
+    /**
+     * Check the mapped file's header and build the tree from its node records.
+     * 
+     * @param copy True to copy every slab, false to probe them in the mapping.
+     * @param verify_checksum True to check the checksum.
+     */
+    void readTree(bool copy, bool verify_checksum);
+
+    /**
+     * Insert a key that was already hashed.
+     * 
+     * @param key The key to insert.
+     */
+    void insertKey(const HashedKey &key);
+
+    /**
+     * Insert a key that was already hashed, locking the nodes it passes.
+     * 
+     * @param key The key to insert.
+     * @param lockNode Called with (level, fingerprint) for every node that may be written, returns the lock to hold
+     *                 for it. An empty lock keeps the lock already held. Full nodes that already have the child
+     *                 are passed without it.
+     */
+    template <typename LockFunction>
+    void insertKey(const HashedKey &key, LockFunction &&lockNode);
+
+    /**
+     * Push a victim down the tree until a node stores it.
+     * 
+     * @param parent The node that kicked the victim out.
+     * @param victim The victim.
+     * @param lockNode See insertKey.
+     * @param held The lock held for parent, replaced as the victim moves down.
+     */
+    template <typename LockFunction>
+    void placeVictim(Node *parent, Victim victim, LockFunction &lockNode, std::unique_lock<std::mutex> &held);
+
+    /**
+     * Get the number of buckets of the nodes at a level.
+     * 
+     * @param level The level.
+     * @return number_of_buckets * growth_factor^level, at most MAX_NODE_BUCKETS.
+     */
+    [[nodiscard]] std::size_t bucketsAt(int level) const;
+
+    /**
+     * Build an empty node in the arenas.
+     * 
+     * @param level The level of the node.
+     * @return The node.
+     */
+    Node *createNode(int level);
+
+    /**
+     * Build a node over a saved bucket slab.
+     * 
+     * @param level The level of the node.
+     * @param slab The saved slab.
+     * @param items The number of fingerprints in the slab.
+     * @param accept_values False if the node stopped taking new values.
+     * @param copy True to copy the slab into the slab arena, false to use it in place.
+     * @return The node.
+     */
+    Node *createNode(int level, const char *slab, std::size_t items, bool accept_values, bool copy);
+
+    /**
+     * Destroy a node built by createNode and give its blocks back to the arenas, its children are left alone.
+     * 
+     * @param node The node, already unlinked and retired.
+     */
+    void destroyNode(Node *node);
+
+    /**
+     * Get the child a fingerprint is routed to, creating it if needed.
+     * 
+     * @param node The parent node.
+     * @param fingerprint The fingerprint.
+     * @return The child node.
+     */
+    Node *childFor(Node *node, uint32_t fingerprint);
+
+    /**
+     * Merge the leaves below a node into it, deepest first.
+     * 
+     * @param node The root of the subtree.
+     * @param prefix The low fingerprint bits of every key routed to the node.
+     * @return The number of nodes freed.
+     */
+    std::size_t compactSubtree(Node *node, uint32_t prefix);
+
+    /**
+     * Copy a leaf's fingerprints into its parent, then unlink the leaf and retire it.
+     * 
+     * Every fingerprint is in the parent before the leaf is unlinked, so readers find it throughout. If the
+     * parent can not take all of them, the copies are removed again and the leaf stays.
+     * 
+     * @param parent The parent node.
+     * @param prefix The low fingerprint bits of every key routed to the leaf, bit parent level picks the child.
+     * @param max_load The share of the parent's capacity both together may fill.
+     * @return True if the leaf was merged.
+     */
+    bool mergeChild(Node *parent, uint32_t prefix, double max_load);
+
+    /**
+     * Allocate the routing table and enter the root, once the fingerprint size is known.
+     */
+    void initRouting();
+
+    /**
+     * Enter a new node in the routing table if its level is routed.
+     * 
+     * @param level The level of the node.
+     * @param fingerprint Any fingerprint routed to the node, only its low level bits are used.
+     * @param node The node.
+     */
+    void route(int level, uint32_t fingerprint, Node *node);
+
+    /**
+     * Get the child a fingerprint is routed to.
+     * 
+     * @param node The parent node.
+     * @param fingerprint The fingerprint.
+     * @return The child node, nullptr if it does not exist.
+     */
+    static Node *nextNode(const Node *node, uint32_t fingerprint);
+
+    /**
+     * Hash every item of a batch.
+     * 
+     * @param items The items to hash.
+     * @return The 64-bit hashes in the same order.
+     */
+    template <typename Items>
+    static std::vector<uint64_t> hashBatch(const Items &items);
+
+    /**
+     * View a byte range as an item without copying it.
+     */
+    static std::string_view toView(const void *data, std::size_t length) {
+        return {static_cast<const char*>(data), length};
+    }
 
     /**
      * Get the prefix of the fingerprint.
@@ -84,4 +511,6 @@ private:
     static bool getPrefix(std::size_t fingerprint, int current_level, std::size_t fingerprintSize);
 };
 
+using LogarithmicDynamicCuckooFilter = BasicLogarithmicDynamicCuckooFilter<>;
+
 #endif // LOG_DCF_HPP
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "NodeArena.hpp"
+
+// Unmap every chunk
+NodeArena::~NodeArena() {
+    for (const auto &chunk : chunks) {
+        munmap(chunk.data, chunk.size);
+    }
+}
+
+// A reused block, a bump in the shared chunk, or a mapping of its own for blocks above half a chunk
+void *NodeArena::allocate(std::size_t bytes) {
+    bytes = (bytes + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto reusable = free_blocks.find(bytes);
+    if (reusable != free_blocks.end() && !reusable->second.empty()) {
+        void *block = reusable->second.back();
+        reusable->second.pop_back();
+        memset(block, 0, bytes);
+        return block;
+    }
+
+    if (bytes > ARENA_CHUNK_SIZE / 2) {
+        return map(bytes).data;
+    }
+    if (bytes > remaining) {
+        // the tail of the old chunk is given up, it is less than the block
+        auto chunk = map(ARENA_CHUNK_SIZE);
+        next = chunk.data;
+        remaining = chunk.size;
+    }
+    void *block = next;
+    next += bytes;
+    remaining -= bytes;
+    return block;
+}
+
+// Keep the block for the next allocation of the same size
+void NodeArena::deallocate(void *block, std::size_t bytes) {
+    bytes = (bytes + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    std::lock_guard<std::mutex> guard(lock);
+    free_blocks[bytes].push_back(block);
+}
+
+// Bytes of every chunk
+std::size_t NodeArena::reserved() const {
+    std::lock_guard<std::mutex> guard(lock);
+    std::size_t total = 0;
+    for (const auto &chunk : chunks) {
+        total += chunk.size;
+    }
+    return total;
+}
+
+// Anonymous private pages, zeroed by the kernel and only backed once touched
+NodeArena::Chunk NodeArena::map(std::size_t bytes) {
+    auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    bytes = (bytes + page - 1) / page * page;
+    void *data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    chunks.push_back(Chunk{static_cast<char*>(data), bytes});
+    return chunks.back();
+}
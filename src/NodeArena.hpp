@@ -0,0 +1,78 @@
+#ifndef NODE_ARENA_HPP
+#define NODE_ARENA_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Bytes mapped at a time, larger blocks get a mapping of their own
+const std::size_t ARENA_CHUNK_SIZE = 4 << 20;
+
+// Alignment and size granularity of every block, a cache line
+const std::size_t ARENA_ALIGNMENT = 64;
+
+/**
+ * Chunked allocator for the nodes of one tree
+ * Blocks are cut from large anonymous mappings, which the kernel hands out zeroed, so a new node costs a
+ * pointer bump instead of a heap allocation and a memset. Freed blocks are kept per size and reused, zeroed
+ * again; the nodes of one level all have the same size. Everything is unmapped at once when the arena goes.
+ */
+class NodeArena {
+public:
+    NodeArena() = default;
+
+    /**
+     * Destructor, unmaps every chunk, nothing allocated from the arena may be used afterwards
+     */
+    ~NodeArena();
+
+    NodeArena(const NodeArena &other) = delete;
+    NodeArena &operator=(const NodeArena &other) = delete;
+
+    /**
+     * Get a zeroed block, safe to call from several threads
+     * @param bytes Size of the block, rounded up to a multiple of ARENA_ALIGNMENT
+     * @return ARENA_ALIGNMENT aligned block
+     * @throws std::bad_alloc if no memory can be mapped
+     */
+    void *allocate(std::size_t bytes);
+
+    /**
+     * Give a block back for reuse
+     * @param block Block from allocate
+     * @param bytes The size it was allocated with
+     */
+    void deallocate(void *block, std::size_t bytes);
+
+    /**
+     * Get the bytes mapped so far
+     * @return Bytes of every chunk, used or not
+     */
+    [[nodiscard]] std::size_t reserved() const;
+
+private:
+    struct Chunk {
+        char *data;
+        std::size_t size;
+    };
+
+    mutable std::mutex lock;
+    std::vector<Chunk> chunks;
+
+    // free space at the end of the last shared chunk
+    char *next = nullptr;
+    std::size_t remaining = 0;
+
+    // freed blocks by rounded size
+    std::unordered_map<std::size_t, std::vector<void*>> free_blocks;
+
+    /**
+     * Map a chunk, with lock held
+     * @param bytes Size of the chunk, rounded up to whole pages
+     * @return The chunk
+     */
+    Chunk map(std::size_t bytes);
+};
+
+#endif // NODE_ARENA_HPP
@@ -0,0 +1,151 @@
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "SequenceReader.hpp"
+
+// Consumed bytes are given back to the kernel in steps of this size
+const std::size_t RELEASE_STEP = 64ULL << 20;
+
+// Constructor
+SequenceReader::SequenceReader(const std::string &path):
+    data(nullptr), size(0), position(0), released(0), format_(Format::FASTQ) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open the file " + path);
+    }
+
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw std::runtime_error("Could not stat the file " + path);
+    }
+    size = static_cast<std::size_t>(file_stat.st_size);
+
+    if (size > 0) {
+        void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Could not map the file " + path);
+        }
+        data = static_cast<const char*>(mapped);
+        madvise(mapped, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    // the first record decides the format
+    std::size_t first = 0;
+    while (first < size && (data[first] == '\n' || data[first] == '\r')) {
+        first++;
+    }
+    if (first < size) {
+        if (data[first] == '>') {
+            format_ = Format::FASTA;
+        } else if (data[first] != '@') {
+            munmap(const_cast<char*>(data), size);
+            throw std::runtime_error("Neither FASTQ nor FASTA: " + path);
+        }
+    }
+}
+
+// Destructor
+SequenceReader::~SequenceReader() {
+    if (data != nullptr) {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+// Read the next record
+bool SequenceReader::next(SequenceRecord &record) {
+    while (position < size && (data[position] == '\n' || data[position] == '\r')) {
+        position++;
+    }
+    if (position >= size) {
+        return false;
+    }
+
+    releaseConsumed();
+
+    char marker = format_ == Format::FASTQ ? '@' : '>';
+    if (data[position] != marker) {
+        throw std::runtime_error("Malformed record at byte " + std::to_string(position));
+    }
+    record.name = readLine().substr(1);
+
+    // sequence lines run until the '+' separator (FASTQ) or the next header (FASTA)
+    char terminator = format_ == Format::FASTQ ? '+' : '>';
+    std::size_t sequence_start = position;
+    std::size_t sequence_end = position;
+    std::size_t bases = 0;
+    while (position < size && data[position] != terminator) {
+        auto line = readLine();
+        if (!line.empty()) {
+            bases += line.size();
+            sequence_end = static_cast<std::size_t>(line.data() - data) + line.size();
+        }
+    }
+    record.sequence = std::string_view(data + sequence_start, sequence_end - sequence_start);
+    record.quality = std::string_view();
+
+    if (format_ == Format::FASTA) {
+        return true;
+    }
+
+    if (position >= size) {
+        throw std::runtime_error("Truncated FASTQ record " + std::string(record.name));
+    }
+    readLine(); // skip '+'
+
+    // the quality has as many characters as the sequence has bases, possibly over several lines too
+    std::size_t quality_start = position;
+    std::size_t quality_end = position;
+    std::size_t scores = 0;
+    while (scores < bases && position < size) {
+        auto line = readLine();
+        scores += line.size();
+        quality_end = static_cast<std::size_t>(line.data() - data) + line.size();
+    }
+    if (scores != bases) {
+        throw std::runtime_error("Quality length does not match sequence length in " + std::string(record.name));
+    }
+    record.quality = std::string_view(data + quality_start, quality_end - quality_start);
+
+    return true;
+}
+
+// Start again from the first record
+void SequenceReader::rewind() {
+    position = 0;
+    released = 0;
+}
+
+// Read one line without its line break
+std::string_view SequenceReader::readLine() {
+    const char *start = data + position;
+    const auto *newline = static_cast<const char*>(memchr(start, '\n', size - position));
+    std::size_t length = newline == nullptr ? size - position : static_cast<std::size_t>(newline - start);
+    position += newline == nullptr ? length : length + 1;
+
+    if (length > 0 && start[length - 1] == '\r') {
+        length--;
+    }
+    return {start, length};
+}
+
+// Drop the pages behind the current record, they are clean and would be faulted in again if touched
+void SequenceReader::releaseConsumed() {
+    if (position - released < RELEASE_STEP) {
+        return;
+    }
+    auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    std::size_t end = position & ~(page_size - 1);
+    madvise(const_cast<char*>(data) + released, end - released, MADV_DONTNEED);
+    released = end;
+}
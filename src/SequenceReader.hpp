@@ -0,0 +1,130 @@
+#ifndef SEQUENCE_READER_HPP
+#define SEQUENCE_READER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+/**
+ * Sequence record
+ * Views into the mapped file, valid as long as the reader that produced them is alive.
+ * A sequence split over several lines keeps its line breaks, KmerEncoder skips them.
+ */
+struct SequenceRecord {
+    std::string_view name;
+    std::string_view sequence;
+    std::string_view quality; // empty for FASTA
+};
+
+/**
+ * Memory mapped FASTQ/FASTA reader
+ * The file is mapped read-only and parsed in place, records are handed out one at a time as views,
+ * nothing is copied. Pages behind the current record are released while reading, so a multi-GB file
+ * is streamed in constant memory.
+ */
+class SequenceReader {
+public:
+    enum class Format { FASTQ, FASTA };
+
+    /**
+     * Constructor
+     * @param path Path of a FASTQ ('@' records) or FASTA ('>' records) file
+     * @throws std::runtime_error if the file can not be opened or mapped, or is in neither format
+     */
+    explicit SequenceReader(const std::string &path);
+
+    /**
+     * Destructor, unmaps the file
+     */
+    ~SequenceReader();
+
+    SequenceReader(const SequenceReader &other) = delete;
+    SequenceReader &operator=(const SequenceReader &other) = delete;
+
+    /**
+     * Read the next record
+     * @param record Filled with the next record
+     * @return False at the end of the file
+     * @throws std::runtime_error on a truncated or malformed record
+     */
+    bool next(SequenceRecord &record);
+
+    /**
+     * Start again from the first record
+     */
+    void rewind();
+
+    /**
+     * Get the format detected from the first record
+     * @return FASTQ or FASTA
+     */
+    [[nodiscard]] Format format() const { return format_; }
+
+    /**
+     * Get the size of the mapped file
+     * @return Size in bytes
+     */
+    [[nodiscard]] std::size_t fileSize() const { return size; }
+
+    /**
+     * Streaming input iterator, for (const auto &record : reader)
+     */
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = SequenceRecord;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const SequenceRecord*;
+        using reference = const SequenceRecord&;
+
+        explicit Iterator(SequenceReader *reader) : reader(reader), record() { advance(); }
+
+        reference operator*() const { return record; }
+        pointer operator->() const { return &record; }
+        Iterator &operator++() { advance(); return *this; }
+        bool operator==(const Iterator &other) const { return reader == other.reader; }
+        bool operator!=(const Iterator &other) const { return reader != other.reader; }
+
+    private:
+        SequenceReader *reader;
+        SequenceRecord record;
+
+        void advance() {
+            if (reader != nullptr && !reader->next(record)) {
+                reader = nullptr;
+            }
+        }
+    };
+
+    /**
+     * Iterate from the current position
+     */
+    Iterator begin() { return Iterator(this); }
+
+    /**
+     * End of the records
+     */
+    static Iterator end() { return Iterator(nullptr); }
+
+private:
+    const char *data;
+    std::size_t size;
+    std::size_t position;
+    std::size_t released;
+    Format format_;
+
+    /**
+     * Read one line, without its line break
+     * @return The line, position moves past the line break
+     */
+    std::string_view readLine();
+
+    /**
+     * Give the pages behind the current position back to the kernel
+     */
+    void releaseConsumed();
+};
+
+#endif // SEQUENCE_READER_HPP
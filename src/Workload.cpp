@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Workload.hpp"
+
+namespace {
+
+const char KEY_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Bits written per key character
+const unsigned KEY_CHARACTER_BITS = 6;
+
+// Bijective 64-bit mixer, the finalizer of splitmix64
+uint64_t mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// log1p(x) / x, accurate around zero
+double helper1(double x) {
+    return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+}
+
+// expm1(x) / x, accurate around zero
+double helper2(double x) {
+    return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1 + x * 0.5 * (1 + x * (1.0 / 3) * (1 + 0.25 * x));
+}
+
+} // namespace
+
+// Precompute the integral bounds of the hat function
+ZipfDistribution::ZipfDistribution(uint64_t n, double exponent): n(n), exponent(exponent) {
+    if (n == 0) {
+        throw std::runtime_error("Zipf distribution needs at least one rank");
+    }
+    if (!(exponent > 0)) {
+        throw std::runtime_error("Zipf exponent must be greater than zero");
+    }
+    h_integral_x1 = hIntegral(1.5) - 1;
+    h_integral_n = hIntegral(static_cast<double>(n) + 0.5);
+    s = 2 - hIntegralInverse(hIntegral(2.5) - h(2));
+}
+
+// Invert a uniform point of the hat integral, accept if it falls under the histogram of the weights
+uint64_t ZipfDistribution::operator()(std::mt19937_64 &rng) const {
+    std::uniform_real_distribution<double> unit(0, 1);
+    while (true) {
+        double u = h_integral_n + unit(rng) * (h_integral_x1 - h_integral_n);
+        double x = hIntegralInverse(u);
+        auto k = static_cast<uint64_t>(std::max(1.0, std::min(x + 0.5, static_cast<double>(n))));
+        if (static_cast<double>(k) - x <= s || u >= hIntegral(static_cast<double>(k) + 0.5) - h(static_cast<double>(k))) {
+            return k;
+        }
+    }
+}
+
+// The weight function 1 / x^exponent
+double ZipfDistribution::h(double x) const {
+    return std::exp(-exponent * std::log(x));
+}
+
+// An antiderivative of h, continuous in the exponent at one
+double ZipfDistribution::hIntegral(double x) const {
+    double log_x = std::log(x);
+    return helper2((1 - exponent) * log_x) * log_x;
+}
+
+// The inverse of hIntegral
+double ZipfDistribution::hIntegralInverse(double x) const {
+    double t = std::max(-1.0, x * (1 - exponent));
+    return std::exp(helper1(t) * x);
+}
+
+// Validate the workload and normalize the ratios
+WorkloadGenerator::WorkloadGenerator(const WorkloadConfig &config):
+    config_(config), rng(config.seed), unit(0, 1), generated_(0), inserted_(0), removed_(0), negatives(0),
+    zipf(1, config.zipf_exponent) {
+    if (config.key_length < MIN_WORKLOAD_KEY_LENGTH) {
+        throw std::runtime_error("Workload keys must be at least " + std::to_string(MIN_WORKLOAD_KEY_LENGTH) + " bytes");
+    }
+    if (config.insert_ratio < 0 || config.query_ratio < 0 || config.remove_ratio < 0 || config.positive_ratio < 0 ||
+        config.positive_ratio > 1) {
+        throw std::runtime_error("Workload ratios must not be negative, the positive ratio at most one");
+    }
+    double total = config.insert_ratio + config.query_ratio + config.remove_ratio;
+    if (!(total > 0)) {
+        throw std::runtime_error("Workload needs at least one operation type");
+    }
+    insert_threshold = config.insert_ratio / total;
+    query_threshold = (config.insert_ratio + config.query_ratio) / total;
+}
+
+// Draw an operation type per slot, keep the present ids in [removed_, inserted_)
+std::size_t WorkloadGenerator::next(std::vector<Operation> &operations, std::size_t count) {
+    operations.clear();
+    count = static_cast<std::size_t>(std::min<uint64_t>(count, config_.operations - generated_));
+    if (keys.size() < count * config_.key_length) {
+        keys.resize(count * config_.key_length);
+    }
+
+    for (std::size_t i = 0; i < count; i++) {
+        char *key = &keys[i * config_.key_length];
+        double draw = unit(rng);
+        if (draw < query_threshold && draw >= insert_threshold) {
+            bool positive = present() > 0 && unit(rng) < config_.positive_ratio;
+            writeKey(positive ? presentId() : negatives++, positive, key);
+            operations.push_back({OperationType::QUERY, positive, {key, config_.key_length}});
+        } else if (draw >= query_threshold && present() > 0) {
+            writeKey(removed_++, true, key);
+            operations.push_back({OperationType::REMOVE, true, {key, config_.key_length}});
+        } else {
+            writeKey(inserted_++, true, key);
+            operations.push_back({OperationType::INSERT, false, {key, config_.key_length}});
+        }
+    }
+    generated_ += count;
+    return count;
+}
+
+// Key of an id, as a string
+std::string WorkloadGenerator::key(uint64_t id, bool present) const {
+    std::string key(config_.key_length, ' ');
+    writeKey(id, present, key.data());
+    return key;
+}
+
+// The first characters spell a bijective mix of the id and its space, the rest are filler derived from it
+void WorkloadGenerator::writeKey(uint64_t id, bool present, char *out) const {
+    uint64_t spelled = mix(((id << 1) | (present ? 0 : 1)) ^ config_.seed);
+    uint64_t filler = spelled;
+    for (std::size_t i = 0; i < config_.key_length; i++) {
+        if (i < MIN_WORKLOAD_KEY_LENGTH) {
+            out[i] = KEY_ALPHABET[(spelled >> (i * KEY_CHARACTER_BITS)) & 63];
+        } else {
+            if ((i - MIN_WORKLOAD_KEY_LENGTH) % 10 == 0) {
+                filler = mix(filler + 0x9e3779b97f4a7c15ULL);
+            }
+            out[i] = KEY_ALPHABET[filler & 63];
+            filler >>= KEY_CHARACTER_BITS;
+        }
+    }
+}
+
+// Uniform over the present ids, or Zipf over their recency with the newest key at rank one
+uint64_t WorkloadGenerator::presentId() {
+    uint64_t live = present();
+    if (config_.distribution == KeyDistribution::UNIFORM) {
+        return removed_ + static_cast<uint64_t>(unit(rng) * static_cast<double>(live)) % live;
+    }
+    // rebuilding costs a few logarithms, so it waits until the present keys differ by 1/64; meanwhile the
+    // oldest keys past the ranks are not drawn and ranks past the present keys are clamped
+    uint64_t slack = zipf.size() / 64;
+    if (live > zipf.size() + slack || live + slack < zipf.size()) {
+        zipf = ZipfDistribution(live, config_.zipf_exponent);
+    }
+    return inserted_ - std::min(zipf(rng), live);
+}
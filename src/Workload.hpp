@@ -0,0 +1,185 @@
+#ifndef WORKLOAD_HPP
+#define WORKLOAD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Keys are at least this long, so the id written into them keeps every key unique
+const std::size_t MIN_WORKLOAD_KEY_LENGTH = 11;
+
+/**
+ * Key popularity of positive queries
+ */
+enum class KeyDistribution { UNIFORM, ZIPFIAN };
+
+/**
+ * Shape of a synthetic workload
+ * The ratios are relative weights, they do not have to add up to one.
+ */
+struct WorkloadConfig {
+    uint64_t operations = 0;
+    std::size_t key_length = 16;
+    double insert_ratio = 1;
+    double query_ratio = 1;
+    double remove_ratio = 0;
+    // share of queries for keys that are present, the others are for keys that never were
+    double positive_ratio = 0.5;
+    KeyDistribution distribution = KeyDistribution::UNIFORM;
+    // the k-th most recently inserted key is queried with weight 1 / k^zipf_exponent
+    double zipf_exponent = 0.99;
+    uint64_t seed = 1;
+};
+
+/**
+ * Zipf distribution over the ranks 1..n by rejection-inversion (Hörmann and Derflinger, 1996)
+ * Constant time per sample and constant space for any n and any exponent greater than zero, no table of
+ * the n weights is built.
+ */
+class ZipfDistribution {
+public:
+    /**
+     * Constructor
+     * @param n Number of ranks, at least one
+     * @param exponent The exponent, greater than zero
+     * @throws std::runtime_error if n or the exponent is out of range
+     */
+    ZipfDistribution(uint64_t n, double exponent);
+
+    /**
+     * Draw a rank
+     * @param rng The random number generator
+     * @return A rank in 1..n, rank k with probability proportional to 1 / k^exponent
+     */
+    uint64_t operator()(std::mt19937_64 &rng) const;
+
+    /**
+     * Get the number of ranks
+     * @return n
+     */
+    [[nodiscard]] uint64_t size() const { return n; }
+
+private:
+    uint64_t n;
+    double exponent;
+    double h_integral_x1;
+    double h_integral_n;
+    double s;
+
+    [[nodiscard]] double h(double x) const;
+    [[nodiscard]] double hIntegral(double x) const;
+    [[nodiscard]] double hIntegralInverse(double x) const;
+};
+
+/**
+ * Type of a generated operation
+ */
+enum class OperationType : uint8_t { INSERT, QUERY, REMOVE };
+
+/**
+ * One generated operation
+ * The key is a view into the generator, valid until its next call to next().
+ */
+struct Operation {
+    OperationType type;
+    // for queries, whether the key is present at this point of the stream
+    bool positive;
+    std::string_view key;
+};
+
+/**
+ * Streaming generator of insert/query/remove mixes
+ * Key i is derived from i and the seed alone, so the stream is reproducible and no key set is held in
+ * memory: 10^9 operations need no more than one batch of keys. Inserts add fresh keys, removes take the
+ * oldest present key, so the present keys are always the ids in [removed, inserted). Positive queries pick
+ * one of them uniformly or by recency with a Zipf distribution, negative queries use keys of a separate id
+ * space that is never inserted. A remove or positive query with no key present becomes an insert or a
+ * negative query.
+ */
+class WorkloadGenerator {
+public:
+    /**
+     * Constructor
+     * @param config The workload
+     * @throws std::runtime_error if the key length is below MIN_WORKLOAD_KEY_LENGTH, a ratio is negative or
+     * all of them are zero, or the Zipf exponent is not positive
+     */
+    explicit WorkloadGenerator(const WorkloadConfig &config);
+
+    WorkloadGenerator(const WorkloadGenerator &other) = delete;
+    WorkloadGenerator &operator=(const WorkloadGenerator &other) = delete;
+
+    /**
+     * Generate the next operations, the keys of the previous call are overwritten
+     * @param operations Replaced with at most count operations
+     * @param count The batch size
+     * @return The number of operations generated, zero once config.operations are done
+     */
+    std::size_t next(std::vector<Operation> &operations, std::size_t count);
+
+    /**
+     * Get the key of an id
+     * @param id The id
+     * @param present True for the ids that get inserted, false for the ids of negative queries
+     * @return The key, config.key_length bytes of [A-Za-z0-9+/]
+     */
+    [[nodiscard]] std::string key(uint64_t id, bool present) const;
+
+    /**
+     * Get the number of operations generated so far
+     */
+    [[nodiscard]] uint64_t generated() const { return generated_; }
+
+    /**
+     * Get the number of keys inserted so far
+     */
+    [[nodiscard]] uint64_t inserted() const { return inserted_; }
+
+    /**
+     * Get the number of keys removed so far
+     */
+    [[nodiscard]] uint64_t removed() const { return removed_; }
+
+    /**
+     * Get the number of keys present after the operations generated so far
+     */
+    [[nodiscard]] uint64_t present() const { return inserted_ - removed_; }
+
+    /**
+     * Get the workload
+     */
+    [[nodiscard]] const WorkloadConfig &config() const { return config_; }
+
+private:
+    WorkloadConfig config_;
+    std::mt19937_64 rng;
+    std::uniform_real_distribution<double> unit;
+    double insert_threshold;
+    double query_threshold;
+    uint64_t generated_;
+    uint64_t inserted_;
+    uint64_t removed_;
+    uint64_t negatives;
+    // rebuilt when the number of present keys has moved too far from its size
+    ZipfDistribution zipf;
+    std::string keys;
+
+    /**
+     * Write the key of an id
+     * @param id The id
+     * @param present True for the inserted id space
+     * @param out config.key_length bytes
+     */
+    void writeKey(uint64_t id, bool present, char *out) const;
+
+    /**
+     * Draw a present id, by the configured popularity
+     * @return An id in [removed_, inserted_), inserted_ must be greater than removed_
+     */
+    uint64_t presentId();
+};
+
+#endif // WORKLOAD_HPP
@@ -2,8 +2,10 @@
 #include <cstdint>
 #include <cstdlib>
 #include <gtest/gtest.h>
+#include <optional>
 #include <string>
 #include <sys/types.h>
+#include <vector>
 
 #include "CF.hpp"
 
@@ -20,11 +22,7 @@ protected:
 
     // Helper function to generate a fingerprint of a given string 
     uint32_t generateFingerprint(const std::string& item, std::size_t fingerprint_size) {
-        std::hash<std::string> hash_fn;
-        std::size_t hash_value = hash_fn(item);
-        uint32_t fingerprint = hash_value & ((1 << fingerprint_size) - 1);
-
-        return fingerprint;
+        return HashedKey::fromHash(CuckooFilter::hash(item), fingerprint_size).fingerprint;
     }
 };
 
@@ -178,6 +176,182 @@ TEST_F(CuckooFilterTest, MultipleLevelsTest) {
     }
 }
 
+TEST_F(CuckooFilterTest, MemoryUsageTest) {
+    // 1024 buckets of 4 x 12 bit fingerprints and 4 occupancy bits are 7 bytes each, stored in one padded slab
+    CuckooFilter cf(1024, 12, 0);
+    EXPECT_GE(cf.memoryUsage(), 1024 * 7);
+    EXPECT_LE(cf.memoryUsage(), sizeof(CuckooFilter) + 1024 * 7 + CACHE_LINE_SIZE);
+}
+
+TEST_F(CuckooFilterTest, HashPoliciesTest) {
+    // the filter works the same with every shipped policy
+    BasicCuckooFilter<StdHashPolicy> std_cf(100, 12, 0);
+    BasicCuckooFilter<WyHashPolicy> wy_cf(100, 12, 0);
+    for (int i = 0; i < 50; i++) {
+        std::string item = "test" + std::to_string(i);
+        EXPECT_EQ(std_cf.insert(item), std::nullopt);
+        EXPECT_EQ(wy_cf.insert(item), std::nullopt);
+    }
+    for (int i = 0; i < 50; i++) {
+        std::string item = "test" + std::to_string(i);
+        EXPECT_EQ(std_cf.contains(item), true);
+        EXPECT_EQ(wy_cf.contains(item), true);
+    }
+
+    // the integer mixer must spread small fingerprints over the whole word
+    EXPECT_NE(WyHashPolicy::hash(uint64_t{1}), uint64_t{1});
+    EXPECT_NE(WyHashPolicy::hash(uint64_t{1}) >> 32, 0);
+    EXPECT_EQ(WyHashPolicy::hash(std::string("ACGT")), WyHashPolicy::hashBytes("ACGT", 4, 0));
+}
+
+TEST_F(CuckooFilterTest, HashedKeyTest) {
+    CuckooFilter cf(100, 12, 0);
+    auto key = cf.hashKey("test");
+    EXPECT_EQ(key.fingerprint, generateFingerprint("test", 12));
+    EXPECT_LT(key.index(128), 128);
+
+    EXPECT_EQ(cf.insert(key), std::nullopt);
+    EXPECT_EQ(cf.contains("test"), true);
+    EXPECT_EQ(cf.contains("test", 4), true);
+    EXPECT_EQ(cf.contains(std::string_view("a test").substr(2)), true);
+    EXPECT_EQ(cf.remove(key), true);
+    EXPECT_EQ(cf.contains(key), false);
+}
+
+TEST_F(CuckooFilterTest, SpecializedKernelsTest) {
+    // compiled width kernels and runtime width kernels build and answer the same, at every width and level
+    for (std::size_t fingerprint_size = 2; fingerprint_size <= 32; fingerprint_size++) {
+        for (int level = 0; level < 2 && static_cast<std::size_t>(level) < fingerprint_size - 1; level++) {
+            CuckooFilter specialized(64, fingerprint_size, level);
+            CuckooFilter generic(64, fingerprint_size, level);
+            specialized.specializeKernels(true);
+            generic.specializeKernels(false);
+
+            for (int i = 0; i < 300; i++) {
+                auto key = HashedKey::fromHash(CuckooFilter::hash("item" + std::to_string(i)), fingerprint_size);
+                EXPECT_EQ(specialized.insert(key).has_value(), generic.insert(key).has_value());
+            }
+            EXPECT_EQ(specialized.size(), generic.size());
+            for (int i = 0; i < 600; i++) {
+                auto key = HashedKey::fromHash(CuckooFilter::hash("item" + std::to_string(i)), fingerprint_size);
+                EXPECT_EQ(specialized.contains(key), generic.contains(key)) << fingerprint_size << " bits, level " << level;
+            }
+        }
+    }
+}
+
+TEST_F(CuckooFilterTest, DefaultKernelsTest) {
+    // byte aligned widths use the compiled kernels, the others only without the AVX2 probe
+    bool scalar = selectProbe() == probeBucketsScalar;
+    for (std::size_t fingerprint_size = MIN_SPECIALIZED_WIDTH; fingerprint_size <= MAX_SPECIALIZED_WIDTH; fingerprint_size++) {
+        CuckooFilter cf(64, fingerprint_size, 0);
+        bool byte_aligned = fingerprint_size == 8 || fingerprint_size == 16 || fingerprint_size == 32;
+        EXPECT_EQ(cf.usesCompiledKernels(), byte_aligned || scalar) << fingerprint_size << " bits";
+        cf.specializeKernels(true);
+        EXPECT_TRUE(cf.usesCompiledKernels());
+        cf.specializeKernels(false);
+        EXPECT_FALSE(cf.usesCompiledKernels());
+    }
+    CuckooFilter narrow(64, MIN_SPECIALIZED_WIDTH - 1, 0);
+    narrow.specializeKernels(true);
+    EXPECT_FALSE(narrow.usesCompiledKernels());
+}
+
+TEST_F(CuckooFilterTest, PathSearchFillsToCapacityTest) {
+    // the cuckoo path search finds room for every key up to the load factor, none is handed to a child
+    for (int level = 0; level < 3; level++) {
+        CuckooFilter cf(1024, 16, level);
+        std::vector<HashedKey> keys;
+        for (uint64_t i = 0; cf.size() < cf.capacity(); i++) {
+            // keys routed to a node share its low fingerprint bits
+            auto key = HashedKey::fromHash(CuckooFilter::hash(i) << level, 16);
+            ASSERT_EQ(cf.insert(key), std::nullopt) << "level " << level << ", " << cf.size() << " items";
+            keys.push_back(key);
+        }
+        EXPECT_TRUE(cf.acceptsValues());
+        for (const auto &key : keys) {
+            EXPECT_TRUE(cf.contains(key));
+        }
+    }
+}
+
+TEST_F(CuckooFilterTest, StashTest) {
+    // fingerprints whose alternate bucket is their first one, all in bucket 0: no path leads out of it
+    CuckooFilter cf(64, 16, 0);
+    std::vector<HashedKey> keys;
+    std::optional<Victim> victim;
+    for (uint32_t fingerprint = 1; !victim.has_value(); fingerprint++) {
+        if (CuckooFilter::hash(fingerprint) % cf.getNumberOfBuckets() != 0) {
+            continue;
+        }
+        auto key = HashedKey{0, fingerprint};
+        victim = cf.insert(key);
+        if (!victim.has_value()) {
+            keys.push_back(key);
+        }
+    }
+    EXPECT_EQ(keys.size(), BUCKET_SIZE + STASH_SIZE);
+    EXPECT_FALSE(cf.acceptsValues());
+
+    // the victim only came once the stash was full, every stashed key is still found
+    Victim stashed[STASH_SIZE];
+    ASSERT_EQ(cf.stashed(stashed), STASH_SIZE);
+    EXPECT_LT(cf.size(), cf.capacity());
+    std::size_t visited = 0;
+    cf.forEachFingerprint([&](std::size_t, uint32_t) { visited++; });
+    EXPECT_EQ(visited, cf.size());
+    for (const auto &key : keys) {
+        EXPECT_TRUE(cf.contains(key));
+    }
+
+    // a stashed key can be removed from the stash
+    auto stashed_key = HashedKey{static_cast<uint64_t>(stashed[0].index) << 32, stashed[0].fingerprint};
+    auto size = cf.size();
+    EXPECT_TRUE(cf.remove(stashed_key));
+    EXPECT_EQ(cf.size(), size - 1);
+    EXPECT_EQ(cf.stashed(stashed), STASH_SIZE - 1);
+
+    // removing the others makes room, the stash drains into the buckets
+    for (std::size_t i = 0; i < keys.size() && cf.stashed(stashed) != 0; i++) {
+        cf.remove(keys[i]);
+    }
+    EXPECT_EQ(cf.stashed(stashed), 0U);
+    visited = 0;
+    cf.forEachFingerprint([&](std::size_t, uint32_t) { visited++; });
+    EXPECT_EQ(visited, cf.size());
+}
+
+TEST_F(CuckooFilterTest, StashDuplicateLimitTest) {
+    // bucket 0 and the alternate bucket of one fingerprint, both filled with fingerprints that can not move
+    CuckooFilter cf(64, 16, 0);
+    auto buckets = cf.getNumberOfBuckets();
+    uint32_t fingerprint = 1;
+    while (CuckooFilter::hash(fingerprint) % buckets == 0) {
+        fingerprint++;
+    }
+    uint64_t alternate = CuckooFilter::hash(fingerprint) % buckets;
+    std::vector<uint32_t> stuck;
+    for (uint32_t candidate = 1; stuck.size() < BUCKET_SIZE + 2; candidate++) {
+        if (CuckooFilter::hash(candidate) % buckets == 0) {
+            stuck.push_back(candidate);
+        }
+    }
+    for (std::size_t i = 0; i < stuck.size(); i++) {
+        auto index = i < BUCKET_SIZE ? 0 : alternate;
+        ASSERT_EQ(cf.insert(HashedKey{index << 32, stuck[i]}), std::nullopt);
+    }
+
+    // two copies fit the alternate bucket, two more go to the stash, then the bucket and stash copies reach the limit
+    auto key = HashedKey{0, fingerprint};
+    Victim stashed[STASH_SIZE];
+    for (std::size_t copies = 1; copies <= BUCKET_SIZE + 2; copies++) {
+        EXPECT_EQ(cf.insert(key), std::nullopt);
+        EXPECT_EQ(cf.size(), stuck.size() + std::min<std::size_t>(copies, BUCKET_SIZE));
+    }
+    EXPECT_EQ(cf.stashed(stashed), 2U);
+    EXPECT_TRUE(cf.acceptsValues());
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
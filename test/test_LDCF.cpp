@@ -3,7 +3,14 @@
 #include <cstdlib>
 #include <gtest/gtest.h>
 #include <string>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <vector>
 #include <sys/types.h>
+#include "CF.hpp"
 #include "LDCF.hpp"
 
 class LogarithmicDynamicCuckooFilterTest : public ::testing::Test {
@@ -19,11 +26,7 @@ protected:
 
     // Helper function to generate a fingerprint of a given string 
     uint32_t generateFingerprint(const std::string& item, std::size_t fingerprint_size) {
-        std::hash<std::string> hash_fn;
-        std::size_t hash_value = hash_fn(item);
-        uint32_t fingerprint = hash_value & ((1 << fingerprint_size) - 1);
-
-        return fingerprint;
+        return HashedKey::fromHash(CuckooFilter::hash(item), fingerprint_size).fingerprint;
     }
 };
 
@@ -85,6 +88,405 @@ TEST_F(LogarithmicDynamicCuckooFilterTest, BigDurabilityTest) {
     }
 }
 
+TEST_F(LogarithmicDynamicCuckooFilterTest, RawHashTest) {
+    // callers with their own 64-bit hashes skip string hashing
+    LogarithmicDynamicCuckooFilter ldCF(0.01, 1000, 2);
+    for (uint64_t i = 0; i < 1000; ++i) {
+        ldCF.insert(WyHashPolicy::hash(i));
+    }
+    EXPECT_EQ(ldCF.size(), 1000);
+    for (uint64_t i = 0; i < 1000; ++i) {
+        EXPECT_EQ(ldCF.contains(WyHashPolicy::hash(i)), true);
+    }
+
+    // a string and its hash are the same key
+    ldCF.insert("test");
+    EXPECT_EQ(ldCF.contains(WyHashPolicy::hash(std::string("test"))), true);
+    EXPECT_EQ(ldCF.remove(WyHashPolicy::hash(std::string("test"))), true);
+    EXPECT_EQ(ldCF.contains("test"), false);
+}
+
+TEST_F(LogarithmicDynamicCuckooFilterTest, BatchTest) {
+    // batched operations agree with the one at a time ones across a multi level tree
+    LogarithmicDynamicCuckooFilter single(0.01, 1000, 2);
+    LogarithmicDynamicCuckooFilter batched(0.01, 1000, 2);
+
+    std::vector<std::string> items;
+    for (int i = 0; i < 5000; ++i) {
+        items.push_back("test" + std::to_string(i));
+    }
+    for (const auto &item : items) {
+        single.insert(item);
+    }
+    batched.insert_batch(items);
+    EXPECT_EQ(batched.size(), items.size());
+
+    std::vector<std::string> queries = items;
+    for (int i = 0; i < 5000; ++i) {
+        queries.push_back("other" + std::to_string(i));
+    }
+    auto bitmap = batched.contains_batch(queries);
+    ASSERT_EQ(bitmap.size(), (queries.size() + 63) / 64);
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+        bool found = ((bitmap[i / 64] >> (i % 64)) & 1ULL) != 0;
+        EXPECT_EQ(found, single.contains(queries[i]));
+        if (i < items.size()) {
+            EXPECT_EQ(found, true);
+        }
+    }
+}
+
+TEST_F(LogarithmicDynamicCuckooFilterTest, ParallelInsertTest) {
+    // sharded inserts from several threads keep every key, the tree grows well past the locked levels
+    LogarithmicDynamicCuckooFilter ldCF(0.001, 1000, 2);
+
+    std::vector<std::string> items;
+    for (int i = 0; i < 50000; ++i) {
+        items.push_back("parallel" + std::to_string(i));
+    }
+    ldCF.insert_parallel(items, 4);
+    EXPECT_EQ(ldCF.size(), items.size());
+
+    for (const auto &item : items) {
+        EXPECT_EQ(ldCF.contains(item), true);
+    }
+
+    // a second round lands on a tree that already has children
+    std::vector<std::string> more;
+    for (int i = 0; i < 20000; ++i) {
+        more.push_back("more" + std::to_string(i));
+    }
+    ldCF.insert_parallel(more, 3);
+    EXPECT_EQ(ldCF.size(), items.size() + more.size());
+    for (const auto &item : more) {
+        EXPECT_EQ(ldCF.contains(item), true);
+    }
+    for (const auto &item : items) {
+        EXPECT_EQ(ldCF.contains(item), true);
+    }
+}
+
+TEST_F(LogarithmicDynamicCuckooFilterTest, ConcurrentReadersTest) {
+    // readers never miss a key the writer finished inserting, while the tree keeps growing under them
+    LogarithmicDynamicCuckooFilter ldCF(0.001, 2000, 2);
+    const std::size_t total = 200000;
+    std::vector<uint64_t> hashes(total);
+    for (std::size_t i = 0; i < total; ++i) {
+        hashes[i] = LogarithmicDynamicCuckooFilter::hash(i);
+    }
+
+    std::atomic<std::size_t> inserted{0};
+    std::atomic<std::size_t> misses{0};
+    std::atomic<int> started{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&, t]() {
+            started++;
+            uint64_t state = 0x9E3779B97F4A7C15ULL * (t + 1);
+            while (true) {
+                auto done = inserted.load(std::memory_order_acquire);
+                if (done == total) {
+                    break;
+                }
+                if (done == 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                if (!ldCF.contains(hashes[state % done])) {
+                    misses++;
+                }
+                uint64_t batch[4];
+                uint64_t found = 0;
+                for (auto &hash : batch) {
+                    hash = hashes[(state >> 8) % done];
+                    state = state * 6364136223846793005ULL + 1;
+                }
+                ldCF.contains_batch(batch, 4, &found);
+                if (found != 0xF) {
+                    misses++;
+                }
+            }
+        });
+    }
+
+    while (started < 3) {
+        std::this_thread::yield();
+    }
+    for (std::size_t i = 0; i < total; ++i) {
+        ldCF.insert(hashes[i]);
+        inserted.store(i + 1, std::memory_order_release);
+    }
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(misses, 0);
+    EXPECT_EQ(ldCF.size(), total);
+}
+
+TEST_F(LogarithmicDynamicCuckooFilterTest, ManyReaderThreadsTest) {
+    // more live lookup threads than one chunk of epoch slots, none of them may fail
+    LogarithmicDynamicCuckooFilter ldCF(0.001, 1000, 2);
+    for (uint64_t i = 0; i < 1000; ++i) {
+        ldCF.insert(LogarithmicDynamicCuckooFilter::hash(i));
+    }
+    const std::size_t readers = EPOCH_CHUNK_SLOTS + 44;
+    std::atomic<std::size_t> found{0};
+    std::atomic<std::size_t> done{0};
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < readers; t++) {
+        threads.emplace_back([&, t]() {
+            found += ldCF.contains(LogarithmicDynamicCuckooFilter::hash(t % 1000)) ? 1 : 0;
+            // a thread keeps its slot until it exits, so all of them hold one at the same time
+            done++;
+            while (done < readers) {
+                std::this_thread::yield();
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(found, readers);
+}
+
+TEST_F(LogarithmicDynamicCuckooFilterTest, SaveLoadTest) {
+    // a multi level tree comes back with the same answers, copied or mapped
+    LogarithmicDynamicCuckooFilter ldCF(0.001, 1000, 2);
+    for (uint64_t i = 0; i < 10000; ++i) {
+        ldCF.insert(LogarithmicDynamicCuckooFilter::hash(i));
+    }
+    std::string path = "ldcf_save_test.bin";
+    ldCF.save(path);
+
+    auto loaded = LogarithmicDynamicCuckooFilter::load(path);
+    auto mapped = LogarithmicDynamicCuckooFilter::open_mapped(path, true);
+    EXPECT_EQ(loaded->size(), ldCF.size());
+    EXPECT_EQ(mapped->size(), ldCF.size());
+    for (uint64_t i = 0; i < 20000; ++i) {
+        auto hash = LogarithmicDynamicCuckooFilter::hash(i);
+        EXPECT_EQ(loaded->contains(hash), ldCF.contains(hash));
+        EXPECT_EQ(mapped->contains(hash), ldCF.contains(hash));
+    }
+
+    // a loaded filter keeps growing, a mapped one is read-only
+    loaded->insert(std::string("new item"));
+    EXPECT_EQ(loaded->contains(std::string("new item")), true);
+    EXPECT_THROW(mapped->insert(std::string("new item")), std::runtime_error);
+    EXPECT_THROW(mapped->remove(LogarithmicDynamicCuckooFilter::hash(uint64_t{1})), std::runtime_error);
+
+    // another hash policy can not read it
+    EXPECT_THROW(BasicLogarithmicDynamicCuckooFilter<StdHashPolicy>::load(path), std::runtime_error);
+
+    // a flipped bit in a bucket slab fails the checksum
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekg(200);
+        char byte = 0;
+        file.read(&byte, 1);
+        byte ^= 1;
+        file.seekp(200);
+        file.write(&byte, 1);
+    }
+    EXPECT_THROW(LogarithmicDynamicCuckooFilter::load(path), std::runtime_error);
+    EXPECT_THROW(LogarithmicDynamicCuckooFilter::open_mapped(path, true), std::runtime_error);
+
+    // truncated files and other files are refused
+    std::filesystem::resize_file(path, 100);
+    EXPECT_THROW(LogarithmicDynamicCuckooFilter::open_mapped(path), std::runtime_error);
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << std::string(128, 'x');
+    }
+    EXPECT_THROW(LogarithmicDynamicCuckooFilter::load(path), std::runtime_error);
+    EXPECT_THROW(LogarithmicDynamicCuckooFilter::load("no_such_filter.bin"), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST_F(LogarithmicDynamicCuckooFilterTest, StashSaveLoadTest) {
+    // short fingerprints have few alternate buckets, paths run out and nodes stash fingerprints
+    LogarithmicDynamicCuckooFilter ldCF(0.2, 2000, 4);
+    for (uint64_t i = 0; i < 200000; ++i) {
+        ldCF.insert(LogarithmicDynamicCuckooFilter::hash(i));
+    }
+    std::string path = "ldcf_stash_test.bin";
+    ldCF.save(path);
+
+    // stashed fingerprints are saved with their node
+    auto loaded = LogarithmicDynamicCuckooFilter::load(path);
+    auto mapped = LogarithmicDynamicCuckooFilter::open_mapped(path, true);
+    EXPECT_EQ(loaded->size(), ldCF.size());
+    for (uint64_t i = 0; i < 200000; ++i) {
+        auto hash = LogarithmicDynamicCuckooFilter::hash(i);
+        ASSERT_TRUE(ldCF.contains(hash));
+        ASSERT_TRUE(loaded->contains(hash));
+        ASSERT_TRUE(mapped->contains(hash));
+    }
+
+    // removes take fingerprints out of stashes too, keys dropped as duplicates find nothing in either filter
+    for (uint64_t i = 0; i < 200000; ++i) {
+        auto hash = LogarithmicDynamicCuckooFilter::hash(i);
+        EXPECT_EQ(loaded->remove(hash), ldCF.remove(hash));
+    }
+    for (uint64_t i = 0; i < 200000; ++i) {
+        ASSERT_FALSE(loaded->contains(LogarithmicDynamicCuckooFilter::hash(i)));
+    }
+    std::remove(path.c_str());
+}
+
+TEST_F(LogarithmicDynamicCuckooFilterTest, DeepTreeTest) {
+    // far past expected_levels the tree runs deeper than the routing table, lookups continue through the children
+    LogarithmicDynamicCuckooFilter ldCF(0.001, 64, 1);
+    for (uint64_t i = 0; i < 60000; ++i) {
+        ldCF.insert(LogarithmicDynamicCuckooFilter::hash(i));
+    }
+    EXPECT_EQ(ldCF.size(), 60000);
+
+    std::string path = "ldcf_deep_test.bin";
+    ldCF.save(path);
+    auto mapped = LogarithmicDynamicCuckooFilter::open_mapped(path);
+    std::remove(path.c_str());
+
+    uint64_t items[64];
+    uint64_t found = 0;
+    for (uint64_t i = 0; i < 60000; ++i) {
+        auto hash = LogarithmicDynamicCuckooFilter::hash(i);
+        EXPECT_EQ(ldCF.contains(hash), true);
+        EXPECT_EQ(mapped->contains(hash), true);
+        items[i % 64] = hash;
+        if (i % 64 == 63) {
+            ldCF.contains_batch(items, 64, &found);
+            EXPECT_EQ(found, ~0ULL);
+        }
+    }
+}
+
+TEST_F(LogarithmicDynamicCuckooFilterTest, GeometricGrowthTest) {
+    // nodes double per level, victims carry the bucket bits the larger children need
+    LogarithmicDynamicCuckooFilter fixed(0.001, 256, 1);
+    LogarithmicDynamicCuckooFilter geometric(0.001, 256, 1, 2);
+    EXPECT_EQ(geometric.growthFactor(), 2U);
+    for (uint64_t i = 0; i < 50000; ++i) {
+        fixed.insert(LogarithmicDynamicCuckooFilter::hash(i));
+        geometric.insert(LogarithmicDynamicCuckooFilter::hash(i));
+    }
+    for (uint64_t i = 0; i < 50000; ++i) {
+        EXPECT_EQ(geometric.contains(LogarithmicDynamicCuckooFilter::hash(i)), true);
+    }
+
+    auto fixed_stats = fixed.stats();
+    auto stats = geometric.stats();
+    EXPECT_LT(stats.max_path_length, fixed_stats.max_path_length);
+    EXPECT_LT(stats.mean_path_length, fixed_stats.mean_path_length);
+    for (const auto &node : stats.node_list) {
+        // capacities are rounded down per node
+        EXPECT_NEAR(static_cast<double>(node.capacity), static_cast<double>(stats.node_list[0].capacity << node.level), 1 << node.level);
+    }
+
+    // the growth factor survives a save
+    std::string path = "ldcf_geometric_test.bin";
+    geometric.save(path);
+    auto loaded = LogarithmicDynamicCuckooFilter::load(path);
+    std::remove(path.c_str());
+    EXPECT_EQ(loaded->growthFactor(), 2U);
+    EXPECT_EQ(loaded->memoryUsage(), geometric.memoryUsage());
+    for (uint64_t i = 50000; i < 60000; ++i) {
+        loaded->insert(LogarithmicDynamicCuckooFilter::hash(i));
+    }
+    for (uint64_t i = 0; i < 60000; ++i) {
+        EXPECT_EQ(loaded->contains(LogarithmicDynamicCuckooFilter::hash(i)), true);
+    }
+
+    // merges copy fingerprints up into smaller parents
+    for (uint64_t i = 0; i < 60000; ++i) {
+        EXPECT_EQ(loaded->remove(LogarithmicDynamicCuckooFilter::hash(i)), true);
+    }
+    loaded->compact();
+    EXPECT_EQ(loaded->stats().nodes, 1U);
+
+    EXPECT_THROW(LogarithmicDynamicCuckooFilter(0.001, 256, 1, 3), std::runtime_error);
+    EXPECT_THROW(LogarithmicDynamicCuckooFilter(0.001, 256, 1, 0), std::runtime_error);
+}
+
+TEST_F(LogarithmicDynamicCuckooFilterTest, CompactTest) {
+    // after heavy churn the tree shrinks back to the live keys, which are all still found
+    LogarithmicDynamicCuckooFilter ldCF(0.001, 2000, 2);
+    LogarithmicDynamicCuckooFilter empty(0.001, 2000, 2);
+    const uint64_t total = 40000;
+    const uint64_t kept = 4000;
+    for (uint64_t i = 0; i < total; ++i) {
+        ldCF.insert(LogarithmicDynamicCuckooFilter::hash(i));
+    }
+    auto peak = ldCF.memoryUsage();
+
+    std::atomic<bool> removing{true};
+    std::atomic<std::size_t> misses{0};
+    std::thread reader([&]() {
+        while (removing.load(std::memory_order_acquire)) {
+            for (uint64_t i = total - kept; i < total; i += 7) {
+                if (!ldCF.contains(LogarithmicDynamicCuckooFilter::hash(i))) {
+                    misses++;
+                }
+            }
+        }
+    });
+    for (uint64_t i = 0; i < total - kept; ++i) {
+        EXPECT_EQ(ldCF.remove(LogarithmicDynamicCuckooFilter::hash(i)), true);
+    }
+    ldCF.compact();
+    removing.store(false, std::memory_order_release);
+    reader.join();
+
+    EXPECT_EQ(misses, 0);
+    EXPECT_EQ(ldCF.size(), kept);
+    // node bytes, without the fixed size parts every filter has
+    EXPECT_LT(ldCF.memoryUsage() - empty.memoryUsage(), (peak - empty.memoryUsage()) / 4);
+    for (uint64_t i = total - kept; i < total; ++i) {
+        EXPECT_EQ(ldCF.contains(LogarithmicDynamicCuckooFilter::hash(i)), true);
+    }
+
+    // nothing left to merge, then only the root once the filter is empty
+    EXPECT_EQ(ldCF.compact(), 0);
+    for (uint64_t i = total - kept; i < total; ++i) {
+        ldCF.remove(LogarithmicDynamicCuckooFilter::hash(i));
+    }
+    ldCF.compact();
+    EXPECT_EQ(ldCF.size(), 0);
+    EXPECT_EQ(ldCF.memoryUsage(), empty.memoryUsage());
+
+    // growing again reuses the blocks of the merged nodes, the arenas map nothing new
+    auto reserved = ldCF.stats().reserved_bytes;
+    for (uint64_t i = 0; i < total; ++i) {
+        ldCF.insert(LogarithmicDynamicCuckooFilter::hash(i));
+    }
+    EXPECT_EQ(ldCF.memoryUsage(), peak);
+    EXPECT_EQ(ldCF.stats().reserved_bytes, reserved);
+}
+
+TEST_F(LogarithmicDynamicCuckooFilterTest, StringViewTest) {
+    // slices of one buffer are keys of their own, no copies needed
+    LogarithmicDynamicCuckooFilter ldCF(0.01, 1000, 2);
+    std::string buffer = "ACGTACGTTTGACCAGTAGGCATCAGT";
+    std::string_view view = buffer;
+    for (std::size_t i = 0; i + 8 <= view.size(); i += 8) {
+        ldCF.insert(view.substr(i, 8));
+    }
+
+    EXPECT_EQ(ldCF.contains(std::string("ACGTACGT")), true);
+    EXPECT_EQ(ldCF.contains(buffer.data() + 8, 8), true);
+    EXPECT_EQ(ldCF.contains(view.substr(16, 8)), true);
+
+    EXPECT_EQ(ldCF.remove(buffer.data() + 8, 8), true);
+    EXPECT_EQ(ldCF.contains(std::string_view("TTGACCAG")), false);
+
+    std::vector<std::string_view> batch{view.substr(0, 8), view.substr(16, 8)};
+    auto bitmap = ldCF.contains_batch(batch);
+    EXPECT_EQ(bitmap[0], 0b11);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
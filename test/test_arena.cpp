@@ -0,0 +1,88 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "NodeArena.hpp"
+
+namespace {
+
+bool isZero(const void *block, std::size_t bytes) {
+    const auto *data = static_cast<const unsigned char*>(block);
+    for (std::size_t i = 0; i < bytes; i++) {
+        if (data[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(NodeArenaTest, AllocateTest) {
+    NodeArena arena;
+    EXPECT_EQ(arena.reserved(), 0U);
+
+    // blocks are aligned, zeroed and do not overlap
+    std::set<uintptr_t> starts;
+    for (std::size_t bytes : {1, 64, 100, 4096, 100000}) {
+        auto *block = static_cast<char*>(arena.allocate(bytes));
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(block) % ARENA_ALIGNMENT, 0U);
+        EXPECT_TRUE(isZero(block, bytes));
+        memset(block, 0xFF, bytes);
+        starts.insert(reinterpret_cast<uintptr_t>(block));
+    }
+    EXPECT_EQ(starts.size(), 5U);
+    EXPECT_EQ(arena.reserved(), ARENA_CHUNK_SIZE);
+
+    // a block above half a chunk gets its own mapping, the shared chunk keeps its free space
+    auto *large = arena.allocate(ARENA_CHUNK_SIZE);
+    EXPECT_TRUE(isZero(large, ARENA_CHUNK_SIZE));
+    EXPECT_EQ(arena.reserved(), 2 * ARENA_CHUNK_SIZE);
+    arena.allocate(64);
+    EXPECT_EQ(arena.reserved(), 2 * ARENA_CHUNK_SIZE);
+}
+
+TEST(NodeArenaTest, ReuseTest) {
+    NodeArena arena;
+    auto *block = static_cast<char*>(arena.allocate(1000));
+    memset(block, 0xFF, 1000);
+    arena.deallocate(block, 1000);
+
+    // a freed block comes back zeroed for the same rounded size only
+    EXPECT_NE(arena.allocate(2000), block);
+    auto *reused = arena.allocate(1000 - 10);
+    EXPECT_EQ(reused, block);
+    EXPECT_TRUE(isZero(reused, 1000));
+}
+
+TEST(NodeArenaTest, ConcurrentTest) {
+    // threads building nodes of different subtrees share the arena
+    NodeArena arena;
+    const int per_thread = 10000;
+    std::vector<std::vector<char*>> blocks(4);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < blocks.size(); t++) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < per_thread; i++) {
+                auto *block = static_cast<char*>(arena.allocate(ARENA_ALIGNMENT));
+                block[0] = static_cast<char>(t + 1);
+                blocks[t].push_back(block);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::set<char*> distinct;
+    for (std::size_t t = 0; t < blocks.size(); t++) {
+        for (auto *block : blocks[t]) {
+            EXPECT_EQ(block[0], static_cast<char>(t + 1));
+            distinct.insert(block);
+        }
+    }
+    EXPECT_EQ(distinct.size(), blocks.size() * per_thread);
+}
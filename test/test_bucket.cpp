@@ -4,7 +4,10 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <utility>
+#include <vector>
 
+#include "BucketProbe.hpp"
 #include "CF.hpp"
 
 TEST(BucketTest, ReadWriteFingerprintSizes2to32) {
@@ -44,6 +47,132 @@ TEST(BucketTest, ReadWriteFingerprintSizes2to32) {
     }
 }
 
+TEST(BucketTest, OccupancyBitsDoNotTouchFingerprints) {
+    for (std::size_t fingerprint_size = 1; fingerprint_size <= 32; ++fingerprint_size) {
+        Bucket bucket;
+        // pad by 8 bytes since reads and writes load a whole uint64_t
+        bucket.bit_array = new char[Bucket::bytesPerBucket(fingerprint_size) + sizeof(uint64_t)]();
+        EXPECT_EQ(bucket.occupancy(fingerprint_size), 0);
+
+        uint32_t mask = fingerprint_size == 32 ? 0xFFFFFFFFU : (1U << fingerprint_size) - 1;
+        for (std::size_t i = 0; i < BUCKET_SIZE; ++i) {
+            bucket.write(i, mask, fingerprint_size);
+        }
+        EXPECT_EQ(bucket.occupancy(fingerprint_size), 0);
+
+        bucket.setOccupied(1, fingerprint_size, true);
+        bucket.setOccupied(3, fingerprint_size, true);
+        EXPECT_EQ(bucket.occupancy(fingerprint_size), 0b1010);
+        EXPECT_TRUE(bucket.isOccupied(3, fingerprint_size));
+        EXPECT_FALSE(bucket.isOccupied(0, fingerprint_size));
+
+        bucket.setOccupied(3, fingerprint_size, false);
+        EXPECT_EQ(bucket.occupancy(fingerprint_size), 0b0010);
+        for (std::size_t i = 0; i < BUCKET_SIZE; ++i) {
+            EXPECT_EQ(bucket.read(i, fingerprint_size), mask);
+        }
+
+        delete[] bucket.bit_array;
+    }
+}
+
+TEST(BucketTest, ProbeKernelsMatchEveryFingerprintSize) {
+    srand(42);
+    auto probe = selectProbe();
+
+    for (std::size_t fingerprint_size = 1; fingerprint_size <= 32; ++fingerprint_size) {
+        auto bytes_per_bucket = Bucket::bytesPerBucket(fingerprint_size);
+        std::vector<char> storage(2 * bytes_per_bucket + sizeof(uint64_t), 0);
+        Bucket first{storage.data()};
+        Bucket second{storage.data() + bytes_per_bucket};
+        uint32_t mask = fingerprint_size == 32 ? 0xFFFFFFFFU : (1U << fingerprint_size) - 1;
+
+        for (int round = 0; round < 100; ++round) {
+            uint32_t needle = rand() & mask;
+            uint32_t expected = 0;
+            for (std::size_t i = 0; i < 2 * BUCKET_SIZE; ++i) {
+                const auto &bucket = i < BUCKET_SIZE ? first : second;
+                // plant the needle in some slots, random values elsewhere
+                uint32_t value = rand() % 3 == 0 ? needle : rand() & mask;
+                bool occupied = rand() % 4 != 0;
+                bucket.write(i % BUCKET_SIZE, value, fingerprint_size);
+                bucket.setOccupied(i % BUCKET_SIZE, fingerprint_size, occupied);
+                if (occupied && value == needle) {
+                    expected |= 1U << i;
+                }
+            }
+
+            EXPECT_EQ(probeBucketsScalar(first.bit_array, second.bit_array, needle, fingerprint_size), expected);
+            EXPECT_EQ(probe(first.bit_array, second.bit_array, needle, fingerprint_size), expected);
+        }
+    }
+}
+
+// Check FixedBucket<Bits> against Bucket with the runtime width on the same bytes
+template <unsigned Bits>
+void checkFixedBucket() {
+    using Fixed = FixedBucket<Bits, BUCKET_SIZE>;
+    auto bytes_per_bucket = Bucket::bytesPerBucket(Bits);
+    std::vector<char> storage(2 * bytes_per_bucket + sizeof(uint64_t), 0);
+    char *first = storage.data();
+    char *second = storage.data() + bytes_per_bucket;
+    uint32_t mask = Bits == 32 ? 0xFFFFFFFFU : (1U << Bits) - 1;
+
+    for (int round = 0; round < 100; ++round) {
+        uint32_t needle = rand() & mask;
+        for (std::size_t i = 0; i < 2 * BUCKET_SIZE; ++i) {
+            char *bucket = i < BUCKET_SIZE ? first : second;
+            uint32_t value = rand() % 3 == 0 ? needle : rand() & mask;
+            bool occupied = rand() % 4 != 0;
+            // writes through either accessor are seen by the other
+            if (i % 2 == 0) {
+                Fixed::write(bucket, i % BUCKET_SIZE, value);
+                Fixed::setOccupied(bucket, i % BUCKET_SIZE, occupied);
+            } else {
+                Bucket{bucket}.write(i % BUCKET_SIZE, value, Bits);
+                Bucket{bucket}.setOccupied(i % BUCKET_SIZE, Bits, occupied);
+            }
+            EXPECT_EQ(Bucket{bucket}.read(i % BUCKET_SIZE, Bits), value);
+            EXPECT_EQ(Fixed::read(bucket, i % BUCKET_SIZE), value);
+        }
+        EXPECT_EQ(Fixed::occupancy(first), Bucket{first}.occupancy(Bits));
+        EXPECT_EQ(Fixed::occupancy(second), Bucket{second}.occupancy(Bits));
+        EXPECT_EQ(Fixed::probe(first, second, needle), probeBucketsScalar(first, second, needle, Bits)) << Bits << " bits";
+    }
+}
+
+template <unsigned... Widths>
+void checkFixedBuckets(std::integer_sequence<unsigned, Widths...>) {
+    (checkFixedBucket<Widths + 1>(), ...);
+}
+
+TEST(BucketTest, FixedBucketMatchesRuntimeWidth) {
+    srand(42);
+    checkFixedBuckets(std::make_integer_sequence<unsigned, 32>{});
+}
+
+TEST(BucketTest, SwarLanesAreExact) {
+    // a lane that differs only in its top bit, or next to a matching lane, must not match
+    using Fixed8 = FixedBucket<8, BUCKET_SIZE>;
+    using Fixed16 = FixedBucket<16, BUCKET_SIZE>;
+    char bucket[16] = {};
+    Fixed8::write(bucket, 0, 0x80);
+    Fixed8::write(bucket, 1, 0x00);
+    Fixed8::write(bucket, 2, 0x01);
+    Fixed8::write(bucket, 3, 0x00);
+    EXPECT_EQ(Fixed8::matches(bucket, 0x00), 0b1010U);
+    EXPECT_EQ(Fixed8::matches(bucket, 0x80), 0b0001U);
+
+    memset(bucket, 0, sizeof(bucket));
+    Fixed16::write(bucket, 0, 0x0001);
+    Fixed16::write(bucket, 1, 0x8000);
+    Fixed16::write(bucket, 2, 0x0000);
+    Fixed16::write(bucket, 3, 0xFFFF);
+    EXPECT_EQ(Fixed16::matches(bucket, 0x0000), 0b0100U);
+    EXPECT_EQ(Fixed16::matches(bucket, 0xFFFF), 0b1000U);
+    EXPECT_EQ(Fixed16::matches(bucket, 0x8000), 0b0010U);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,122 @@
+#include <atomic>
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "Epoch.hpp"
+
+// Counts its own destruction
+struct Tracked {
+    explicit Tracked(std::atomic<int> *deleted) : deleted(deleted) {}
+    ~Tracked() { (*deleted)++; }
+    std::atomic<int> *deleted;
+};
+
+TEST(EpochManagerTest, RetiredObjectOutlivesPinnedReader) {
+    EpochManager epochs;
+    std::atomic<int> deleted{0};
+
+    {
+        auto guard = epochs.pin();
+        epochs.retire(new Tracked(&deleted));
+
+        // the reader pinned before the object was retired may still hold it
+        EXPECT_EQ(epochs.collect(), 0);
+        EXPECT_EQ(epochs.pending(), 1);
+        EXPECT_EQ(deleted, 0);
+    }
+
+    EXPECT_EQ(epochs.collect(), 1);
+    EXPECT_EQ(epochs.pending(), 0);
+    EXPECT_EQ(deleted, 1);
+}
+
+TEST(EpochManagerTest, LaterReadersDoNotHoldBackReclamation) {
+    EpochManager epochs;
+    std::atomic<int> deleted{0};
+
+    epochs.retire(new Tracked(&deleted));
+    {
+        // pinned after the retire, it can not have seen the object
+        auto guard = epochs.pin();
+        auto nested = epochs.pin();
+        EXPECT_EQ(epochs.collect(), 1);
+    }
+    EXPECT_EQ(deleted, 1);
+}
+
+TEST(EpochManagerTest, ReaderOnAnotherThread) {
+    EpochManager epochs;
+    std::atomic<int> deleted{0};
+    std::atomic<bool> pinned{false};
+    std::atomic<bool> release{false};
+
+    std::thread reader([&]() {
+        auto guard = epochs.pin();
+        pinned = true;
+        while (!release) {
+            std::this_thread::yield();
+        }
+    });
+    while (!pinned) {
+        std::this_thread::yield();
+    }
+
+    epochs.retire(new Tracked(&deleted));
+    EXPECT_EQ(epochs.collect(), 0);
+
+    release = true;
+    reader.join();
+    EXPECT_EQ(epochs.collect(), 1);
+    EXPECT_EQ(deleted, 1);
+}
+
+TEST(EpochManagerTest, DestructorFreesPending) {
+    std::atomic<int> deleted{0};
+    {
+        EpochManager epochs;
+        epochs.retire(new Tracked(&deleted));
+        epochs.retire(new Tracked(&deleted));
+    }
+    EXPECT_EQ(deleted, 2);
+}
+
+TEST(EpochManagerTest, MoreThreadsThanAChunk) {
+    // every live thread keeps a slot, past the first chunk the manager appends more
+    EpochManager epochs;
+    std::atomic<int> deleted{0};
+    std::atomic<std::size_t> pinned{0};
+    std::atomic<bool> release{false};
+    const std::size_t readers = EPOCH_CHUNK_SLOTS * 2 + 10;
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < readers; i++) {
+        threads.emplace_back([&]() {
+            auto guard = epochs.pin();
+            pinned++;
+            while (!release) {
+                std::this_thread::yield();
+            }
+        });
+    }
+    while (pinned < readers) {
+        std::this_thread::yield();
+    }
+
+    // every one of them holds the object back, in whichever chunk its slot is
+    epochs.retire(new Tracked(&deleted));
+    EXPECT_EQ(epochs.collect(), 0);
+
+    release = true;
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(epochs.collect(), 1);
+    EXPECT_EQ(deleted, 1);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
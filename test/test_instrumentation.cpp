@@ -0,0 +1,78 @@
+#include <cstddef>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <string>
+#include <thread>
+
+#include "Instrumentation.hpp"
+#include "LDCF.hpp"
+
+namespace {
+
+uint64_t total(const std::array<uint64_t, HISTOGRAM_BINS> &histogram) {
+    return std::accumulate(histogram.begin(), histogram.end(), uint64_t{0});
+}
+
+} // namespace
+
+TEST(InstrumentationTest, CountsFilterOperations) {
+    Instrumentation::reset();
+    LogarithmicDynamicCuckooFilter ldCF(0.001, 1000, 2);
+    const uint64_t keys = 5000;
+    for (uint64_t i = 0; i < keys; ++i) {
+        ldCF.insert(LogarithmicDynamicCuckooFilter::hash(i));
+    }
+    for (uint64_t i = 0; i < keys; ++i) {
+        EXPECT_EQ(ldCF.contains(LogarithmicDynamicCuckooFilter::hash(i)), true);
+    }
+    for (uint64_t i = 0; i < 100; ++i) {
+        ldCF.remove(LogarithmicDynamicCuckooFilter::hash(i));
+    }
+    auto snapshot = Instrumentation::snapshot();
+
+    if (!Instrumentation::enabled) {
+        // compiled out, nothing is counted
+        for (auto counter : snapshot.counters) {
+            EXPECT_EQ(counter, 0);
+        }
+        for (const auto &histogram : snapshot.histograms) {
+            EXPECT_EQ(total(histogram), 0);
+        }
+        return;
+    }
+
+    // every insert into the tree lands in exactly one node, every lookup walks one path
+    EXPECT_EQ(snapshot[Counter::INSERTS], keys);
+    EXPECT_EQ(snapshot[Counter::LOOKUPS], keys);
+    EXPECT_GE(snapshot[Counter::NODE_PROBES], keys);
+    EXPECT_EQ(snapshot[Counter::REMOVES] - snapshot[Counter::REMOVE_MISSES], 100);
+    EXPECT_GT(snapshot[Counter::NODES_CREATED], 0);
+    EXPECT_EQ(total(snapshot[Histogram::DUPLICATE_MATCHES]), keys);
+    EXPECT_EQ(total(snapshot[Histogram::INSERT_DEPTH]), keys);
+    EXPECT_EQ(total(snapshot[Histogram::INSERT_LATENCY]), keys);
+    EXPECT_EQ(total(snapshot[Histogram::LOOKUP_PATH]), keys);
+    EXPECT_EQ(total(snapshot[Histogram::LOOKUP_LATENCY]), keys);
+    // stashed fingerprints record their path once a remove lets them into a bucket
+    EXPECT_EQ(total(snapshot[Histogram::PATH_LENGTH]), keys + snapshot[Counter::VICTIM_INSERTS] -
+                                                       snapshot[Counter::INSERT_VICTIMS] - snapshot[Counter::DUPLICATE_REJECTS] -
+                                                       snapshot[Counter::STASHED] + snapshot[Counter::STASH_DRAINS]);
+    EXPECT_NE(snapshot.toJson().find("\"inserts\":" + std::to_string(keys)), std::string::npos);
+}
+
+TEST(InstrumentationTest, KeepsCountsOfExitedThreads) {
+    LogarithmicDynamicCuckooFilter ldCF(0.01, 1000, 1);
+    Instrumentation::reset();
+    std::size_t found = 0;
+    std::thread reader([&]() {
+        for (uint64_t i = 0; i < 100; ++i) {
+            found += ldCF.contains(i) ? 1 : 0;
+        }
+    });
+    reader.join();
+    EXPECT_LT(found, 100);
+    EXPECT_EQ(Instrumentation::snapshot()[Counter::LOOKUPS], Instrumentation::enabled ? 100 : 0);
+
+    Instrumentation::reset();
+    EXPECT_EQ(Instrumentation::snapshot()[Counter::LOOKUPS], 0);
+}
@@ -0,0 +1,104 @@
+#include <cstddef>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Kmer.hpp"
+#include "LDCF.hpp"
+
+// Helper function to collect the k-mers of a sequence
+std::vector<uint64_t> collectKmers(const KmerEncoder& encoder, const std::string& sequence) {
+    std::vector<uint64_t> kmers;
+    encoder.forEach(sequence, [&](uint64_t kmer) { kmers.push_back(kmer); });
+    return kmers;
+}
+
+// Helper function to build the reverse complement of a sequence
+std::string reverseComplement(const std::string& sequence) {
+    std::string result(sequence.rbegin(), sequence.rend());
+    for (auto& base : result) {
+        switch (base) {
+            case 'A': base = 'T'; break;
+            case 'C': base = 'G'; break;
+            case 'G': base = 'C'; break;
+            default: base = 'A'; break;
+        }
+    }
+    return result;
+}
+
+TEST(KmerEncoderTest, ForwardEncodingTest) {
+    KmerEncoder encoder(3, false);
+    auto kmers = collectKmers(encoder, "ACGTA");
+    ASSERT_EQ(kmers.size(), 3);
+    EXPECT_EQ(kmers[0], 0b000110); // ACG
+    EXPECT_EQ(kmers[1], 0b011011); // CGT
+    EXPECT_EQ(kmers[2], 0b101100); // GTA
+    EXPECT_EQ(encoder.decode(kmers[2]), "GTA");
+    EXPECT_EQ(encoder.count("ACGTA"), 3);
+}
+
+TEST(KmerEncoderTest, NResetsWindowTest) {
+    KmerEncoder encoder(4, false);
+    // ACGTN breaks the window, only ACGT and TTGA/TGAC remain
+    auto kmers = collectKmers(encoder, "ACGTNTTGAC");
+    ASSERT_EQ(kmers.size(), 3);
+    EXPECT_EQ(encoder.decode(kmers[0]), "ACGT");
+    EXPECT_EQ(encoder.decode(kmers[1]), "TTGA");
+    EXPECT_EQ(encoder.decode(kmers[2]), "TGAC");
+
+    // lowercase bases are valid, short runs between Ns yield nothing
+    EXPECT_EQ(encoder.count("acgtNACGNNA"), 1);
+
+    // line breaks of a multi-line FASTA sequence do not break k-mers
+    EXPECT_EQ(collectKmers(encoder, "AC\nGT\r\nA"), collectKmers(encoder, "ACGTA"));
+}
+
+TEST(KmerEncoderTest, CanonicalTest) {
+    std::string sequence = "ACGGTCAGTTCAGGACTTAGCATGACCATGACGGTACGATCCAGT";
+    for (std::size_t k = 1; k <= MAX_KMER_SIZE; ++k) {
+        KmerEncoder canonical(k, true);
+        KmerEncoder forward(k, false);
+
+        // a sequence and its reverse complement have the same canonical k-mers
+        auto kmers = collectKmers(canonical, sequence);
+        auto reverse_kmers = collectKmers(canonical, reverseComplement(sequence));
+        EXPECT_EQ(std::multiset<uint64_t>(kmers.begin(), kmers.end()),
+                  std::multiset<uint64_t>(reverse_kmers.begin(), reverse_kmers.end()));
+
+        // and a canonical k-mer is the smaller of the two strands
+        auto forward_kmers = collectKmers(forward, sequence);
+        ASSERT_EQ(forward_kmers.size(), sequence.size() - k + 1);
+        for (std::size_t i = 0; i < forward_kmers.size(); ++i) {
+            EXPECT_EQ(forward.decode(forward_kmers[i]), sequence.substr(i, k));
+            auto reverse = collectKmers(forward, reverseComplement(sequence.substr(i, k)));
+            EXPECT_EQ(kmers[i], std::min(forward_kmers[i], reverse[0]));
+        }
+    }
+}
+
+TEST(KmerEncoderTest, InvalidKTest) {
+    EXPECT_THROW(KmerEncoder(0, false), std::invalid_argument);
+    EXPECT_THROW(KmerEncoder(33, false), std::invalid_argument);
+}
+
+TEST(KmerEncoderTest, FilterTest) {
+    KmerEncoder encoder(21, true);
+    LogarithmicDynamicCuckooFilter ldCF(0.01, 1000, 2);
+    std::string read = "CCGAGCTCATCGAGGAACCACTCGCCGTATCCCAGTTGATCGCCAAGCCCATACAGCGCAACAATTTTACC";
+
+    auto inserted = insertKmers(ldCF, encoder, read);
+    EXPECT_EQ(inserted, read.size() - 21 + 1);
+    EXPECT_EQ(ldCF.size(), inserted);
+
+    // every k-mer is found, also from the other strand
+    EXPECT_EQ(countKmers(ldCF, encoder, read), inserted);
+    EXPECT_EQ(countKmers(ldCF, encoder, reverseComplement(read)), inserted);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
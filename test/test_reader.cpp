@@ -0,0 +1,102 @@
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "Kmer.hpp"
+#include "SequenceReader.hpp"
+
+class SequenceReaderTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        for (const auto &path : paths) {
+            std::remove(path.c_str());
+        }
+    }
+
+    // Helper function to write a temporary file
+    std::string writeFile(const std::string &contents) {
+        std::string path = "sequence_reader_test_" + std::to_string(paths.size()) + ".txt";
+        std::ofstream file(path, std::ios::binary);
+        file << contents;
+        paths.push_back(path);
+        return path;
+    }
+
+    std::vector<std::string> paths;
+};
+
+TEST_F(SequenceReaderTest, FastqTest) {
+    auto path = writeFile("@read1\nACGT\n+\nIIII\n@read2 extra\r\nGGCCA\r\n+read2\r\n@@@@@\r\n");
+    SequenceReader reader(path);
+    EXPECT_EQ(reader.format(), SequenceReader::Format::FASTQ);
+
+    SequenceRecord record;
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.name, "read1");
+    EXPECT_EQ(record.sequence, "ACGT");
+    EXPECT_EQ(record.quality, "IIII");
+
+    // quality lines may start with '@', CRLF line breaks are stripped
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.name, "read2 extra");
+    EXPECT_EQ(record.sequence, "GGCCA");
+    EXPECT_EQ(record.quality, "@@@@@");
+
+    EXPECT_FALSE(reader.next(record));
+}
+
+TEST_F(SequenceReaderTest, MultiLineFastaTest) {
+    auto path = writeFile(">chr1\nACGT\nTTGA\n\n>chr2\nGG");
+    SequenceReader reader(path);
+    EXPECT_EQ(reader.format(), SequenceReader::Format::FASTA);
+
+    std::vector<SequenceRecord> records(reader.begin(), SequenceReader::end());
+    ASSERT_EQ(records.size(), 2);
+    EXPECT_EQ(records[0].name, "chr1");
+    EXPECT_EQ(records[0].sequence, "ACGT\nTTGA");
+    EXPECT_TRUE(records[0].quality.empty());
+    EXPECT_EQ(records[1].sequence, "GG");
+
+    // k-mers run across the line break
+    KmerEncoder encoder(8, false);
+    EXPECT_EQ(encoder.count(records[0].sequence), 1);
+
+    reader.rewind();
+    SequenceRecord record;
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.name, "chr1");
+}
+
+TEST_F(SequenceReaderTest, MalformedTest) {
+    EXPECT_THROW(SequenceReader("no_such_file.fq"), std::runtime_error);
+    EXPECT_THROW(SequenceReader(writeFile("ACGT\n")), std::runtime_error);
+
+    // quality shorter than the sequence
+    SequenceReader truncated(writeFile("@read\nACGT\n+\nII\n"));
+    SequenceRecord record;
+    EXPECT_THROW(truncated.next(record), std::runtime_error);
+
+    // an empty file has no records
+    SequenceReader empty(writeFile(""));
+    EXPECT_FALSE(empty.next(record));
+}
+
+TEST_F(SequenceReaderTest, BenchmarkFilesTest) {
+    // the bundled reads are 1000 records of 100 bases each
+    SequenceReader reader(std::string(LDCF_SOURCE_DIR) + "/benchmarks/reads_1.fq");
+    std::size_t records = 0;
+    for (const auto &record : reader) {
+        EXPECT_EQ(record.sequence.size(), 100);
+        EXPECT_EQ(record.quality.size(), 100);
+        records++;
+    }
+    EXPECT_EQ(records, 1000);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,86 @@
+#include <cstddef>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+
+#include "FilterStats.hpp"
+#include "LDCF.hpp"
+
+TEST(FilterStatsTest, StatsDescribeTheTree) {
+    LogarithmicDynamicCuckooFilter ldCF(0.001, 20000, 2);
+    auto empty = ldCF.stats();
+    EXPECT_EQ(empty.items, 0);
+    EXPECT_EQ(empty.nodes, 1);
+    EXPECT_EQ(empty.bits_per_item, 0);
+    EXPECT_EQ(empty.false_positive_rate, 0);
+    EXPECT_EQ(empty.capacity, ldCF.capacity());
+
+    std::mt19937_64 rng(7);
+    for (int i = 0; i < 30000; ++i) {
+        ldCF.insert(rng());
+    }
+    auto stats = ldCF.stats();
+    EXPECT_EQ(stats.items, 30000);
+    EXPECT_EQ(stats.total_bytes, ldCF.memoryUsage());
+    EXPECT_EQ(stats.capacity, ldCF.capacity());
+    EXPECT_GE(stats.capacity, stats.items);
+    EXPECT_GE(stats.reserved_bytes, stats.fingerprint_bytes + stats.occupancy_bytes + stats.padding_bytes);
+    EXPECT_DOUBLE_EQ(stats.bits_per_item, 8.0 * ldCF.memoryUsage() / 30000);
+
+    // every node is counted once, at its level, and holds what the filter holds
+    ASSERT_EQ(stats.node_list.size(), stats.nodes);
+    std::size_t nodes = 0;
+    for (auto count : stats.nodes_per_level) {
+        nodes += count;
+    }
+    EXPECT_EQ(nodes, stats.nodes);
+    EXPECT_EQ(stats.nodes_per_level[0], 1);
+    std::size_t items = 0;
+    for (const auto &node : stats.node_list) {
+        items += node.items;
+        EXPECT_LE(node.load_factor, LOAD_FACTOR);
+        EXPECT_EQ(node.fingerprint_bits, stats.node_list[0].fingerprint_bits - node.level);
+    }
+    EXPECT_EQ(items, stats.items);
+    EXPECT_EQ(stats.max_path_length, stats.nodes_per_level.size());
+    EXPECT_GE(stats.mean_path_length, 1);
+    EXPECT_LE(stats.mean_path_length, stats.max_path_length);
+
+    // the estimate is close to the rate measured with keys that were never inserted
+    std::size_t false_positives = 0;
+    const int probes = 400000;
+    for (int i = 0; i < probes; ++i) {
+        false_positives += ldCF.contains(rng()) ? 1 : 0;
+    }
+    double measured = static_cast<double>(false_positives) / probes;
+    EXPECT_GT(stats.false_positive_rate, measured / 2);
+    EXPECT_LT(stats.false_positive_rate, measured * 2);
+}
+
+TEST(FilterStatsTest, Json) {
+    FilterStats stats;
+    stats.items = 3;
+    stats.capacity = 7;
+    stats.nodes = 2;
+    stats.nodes_per_level = {1, 1};
+    stats.node_list = {NodeStats{0, 2, 3, 0.5, 12}, NodeStats{1, 1, 4, 0.25, 11}};
+    stats.fingerprint_bytes = 12;
+    stats.occupancy_bytes = 1;
+    stats.padding_bytes = 3;
+    stats.node_overhead_bytes = 100;
+    stats.filter_overhead_bytes = 200;
+    stats.total_bytes = 316;
+    stats.reserved_bytes = 4096;
+    stats.bits_per_item = 842.5;
+    stats.max_path_length = 2;
+    stats.mean_path_length = 1.5;
+    stats.false_positive_rate = 0.001;
+
+    EXPECT_EQ(stats.toJson(),
+              "{\"items\":3,\"capacity\":7,\"nodes\":2,\"nodes_per_level\":[1,1],"
+              "\"bytes\":{\"total\":316,\"fingerprints\":12,\"occupancy\":1,\"padding\":3,\"node_overhead\":100,\"filter_overhead\":200,\"reserved\":4096},"
+              "\"bits_per_item\":842.5,\"path_length\":{\"max\":2,\"mean\":1.5},\"false_positive_rate\":0.001,"
+              "\"node_list\":[{\"level\":0,\"items\":2,\"capacity\":3,\"load_factor\":0.5,\"fingerprint_bits\":12},"
+              "{\"level\":1,\"items\":1,\"capacity\":4,\"load_factor\":0.25,\"fingerprint_bits\":11}]}");
+}
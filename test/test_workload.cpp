@@ -0,0 +1,209 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Workload.hpp"
+
+namespace {
+
+// Generate the whole workload and tally it, checking every operation against the present keys
+struct Replay {
+    std::size_t inserts = 0;
+    std::size_t removes = 0;
+    std::size_t positive_queries = 0;
+    std::size_t negative_queries = 0;
+    std::unordered_set<std::string> present;
+    // insert number of every key
+    std::unordered_map<std::string, std::size_t> ever_inserted;
+    // inserts since the key of each positive query was inserted
+    std::vector<std::size_t> positive_ages;
+
+    explicit Replay(WorkloadGenerator &generator, std::size_t batch) {
+        std::vector<Operation> operations;
+        while (generator.next(operations, batch) != 0) {
+            for (const auto &operation : operations) {
+                std::string key(operation.key);
+                switch (operation.type) {
+                    case OperationType::INSERT:
+                        EXPECT_TRUE(ever_inserted.emplace(key, inserts).second) << "key inserted twice";
+                        present.insert(key);
+                        inserts++;
+                        break;
+                    case OperationType::REMOVE:
+                        removes++;
+                        EXPECT_EQ(present.erase(key), 1U) << "removed a key that is not present";
+                        break;
+                    case OperationType::QUERY:
+                        if (operation.positive) {
+                            positive_queries++;
+                            EXPECT_EQ(present.count(key), 1U) << "positive query for an absent key";
+                            positive_ages.push_back(inserts - ever_inserted[key]);
+                        } else {
+                            negative_queries++;
+                            EXPECT_EQ(ever_inserted.count(key), 0U) << "negative query for an inserted key";
+                        }
+                        break;
+                }
+            }
+        }
+    }
+};
+
+} // namespace
+
+TEST(WorkloadTest, MixTest) {
+    WorkloadConfig config;
+    config.operations = 100000;
+    config.insert_ratio = 5;
+    config.query_ratio = 4;
+    config.remove_ratio = 1;
+    config.positive_ratio = 0.75;
+    WorkloadGenerator generator(config);
+    Replay replay(generator, 1000);
+
+    EXPECT_EQ(generator.generated(), config.operations);
+    EXPECT_EQ(replay.inserts + replay.removes + replay.positive_queries + replay.negative_queries, config.operations);
+    EXPECT_EQ(generator.inserted(), replay.inserts);
+    EXPECT_EQ(generator.removed(), replay.removes);
+    EXPECT_EQ(generator.present(), replay.present.size());
+
+    EXPECT_NEAR(replay.inserts / 100000.0, 0.5, 0.01);
+    EXPECT_NEAR(replay.removes / 100000.0, 0.1, 0.01);
+    double queries = replay.positive_queries + replay.negative_queries;
+    EXPECT_NEAR(queries / 100000.0, 0.4, 0.01);
+    EXPECT_NEAR(replay.positive_queries / queries, 0.75, 0.02);
+}
+
+TEST(WorkloadTest, ReproducibleTest) {
+    WorkloadConfig config;
+    config.operations = 5000;
+    config.remove_ratio = 0.5;
+    config.distribution = KeyDistribution::ZIPFIAN;
+
+    WorkloadGenerator first(config);
+    WorkloadGenerator second(config);
+    std::vector<Operation> a;
+    std::vector<Operation> b;
+    // batch boundaries do not change the stream
+    std::vector<std::string> first_keys;
+    while (first.next(a, 777) != 0) {
+        for (const auto &operation : a) {
+            first_keys.emplace_back(operation.key);
+        }
+    }
+    std::size_t i = 0;
+    while (second.next(b, 1024) != 0) {
+        for (const auto &operation : b) {
+            ASSERT_LT(i, first_keys.size());
+            EXPECT_EQ(first_keys[i++], operation.key);
+        }
+    }
+    EXPECT_EQ(i, first_keys.size());
+
+    config.seed = 2;
+    WorkloadGenerator reseeded(config);
+    EXPECT_NE(reseeded.key(0, true), first.key(0, true));
+    EXPECT_EQ(first.key(42, true), second.key(42, true));
+    EXPECT_NE(first.key(42, true), first.key(42, false));
+    EXPECT_EQ(first.key(42, true).size(), config.key_length);
+}
+
+TEST(WorkloadTest, EmptyFilterTest) {
+    // with nothing inserted every query is negative
+    WorkloadConfig config;
+    config.operations = 1000;
+    config.insert_ratio = 0;
+    config.positive_ratio = 1;
+    WorkloadGenerator generator(config);
+    Replay replay(generator, 100);
+    EXPECT_EQ(replay.positive_queries, 0U);
+    EXPECT_EQ(replay.negative_queries, 1000U);
+
+    // a remove with nothing present inserts, so removes alone alternate
+    config.query_ratio = 0;
+    config.remove_ratio = 1;
+    WorkloadGenerator removes(config);
+    Replay alternating(removes, 100);
+    EXPECT_EQ(alternating.inserts, 500U);
+    EXPECT_EQ(alternating.removes, 500U);
+}
+
+// Share of positive queries for one of the ten newest keys
+double recentShare(const Replay &replay) {
+    std::size_t recent = 0;
+    for (auto age : replay.positive_ages) {
+        recent += age <= 10 ? 1 : 0;
+    }
+    return static_cast<double>(recent) / replay.positive_ages.size();
+}
+
+TEST(WorkloadTest, ZipfianTest) {
+    WorkloadConfig config;
+    config.operations = 200000;
+    config.insert_ratio = 1;
+    config.query_ratio = 9;
+    config.positive_ratio = 1;
+    config.distribution = KeyDistribution::ZIPFIAN;
+    config.zipf_exponent = 1.2;
+    WorkloadGenerator generator(config);
+    Replay replay(generator, 4096);
+
+    // the newest keys are the hot ones, ranks 1..10 carry about half the weight at this exponent
+    EXPECT_GT(recentShare(replay), 0.4);
+
+    config.distribution = KeyDistribution::UNIFORM;
+    WorkloadGenerator uniform_generator(config);
+    Replay uniform(uniform_generator, 4096);
+    EXPECT_LT(recentShare(uniform), 0.05);
+}
+
+TEST(WorkloadTest, ZipfDistributionTest) {
+    std::mt19937_64 rng(7);
+    for (double exponent : {0.5, 0.99, 1.0, 1.5}) {
+        const uint64_t n = 10;
+        ZipfDistribution zipf(n, exponent);
+        std::vector<double> counts(n + 1, 0);
+        const int draws = 200000;
+        for (int i = 0; i < draws; i++) {
+            auto rank = zipf(rng);
+            ASSERT_GE(rank, 1U);
+            ASSERT_LE(rank, n);
+            counts[rank]++;
+        }
+        double norm = 0;
+        for (uint64_t k = 1; k <= n; k++) {
+            norm += std::pow(static_cast<double>(k), -exponent);
+        }
+        for (uint64_t k = 1; k <= n; k++) {
+            double expected = std::pow(static_cast<double>(k), -exponent) / norm;
+            EXPECT_NEAR(counts[k] / draws, expected, 0.01) << "exponent " << exponent << " rank " << k;
+        }
+    }
+
+    ZipfDistribution single(1, 0.99);
+    EXPECT_EQ(single(rng), 1U);
+    EXPECT_THROW(ZipfDistribution(0, 1), std::runtime_error);
+    EXPECT_THROW(ZipfDistribution(10, 0), std::runtime_error);
+}
+
+TEST(WorkloadTest, InvalidConfigTest) {
+    WorkloadConfig config;
+    config.key_length = MIN_WORKLOAD_KEY_LENGTH - 1;
+    EXPECT_THROW(WorkloadGenerator{config}, std::runtime_error);
+
+    config = WorkloadConfig();
+    config.insert_ratio = 0;
+    config.query_ratio = 0;
+    EXPECT_THROW(WorkloadGenerator{config}, std::runtime_error);
+
+    config = WorkloadConfig();
+    config.positive_ratio = 1.5;
+    EXPECT_THROW(WorkloadGenerator{config}, std::runtime_error);
+}